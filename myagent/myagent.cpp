@@ -7,7 +7,24 @@
 #include <iomanip>
 #include <numeric>
 #include <cmath>
-#include <unordered_map>
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <mutex>
+#include <map>
+#include <queue>
+#include <condition_variable>
+#include <set>
+#include <functional>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 using namespace std;
 
@@ -35,572 +52,3903 @@ inline void line_tokenization(const string s, vector <int> &arr) {
 }
 
 /*
- This is a immutable class!
+ One test case of input.txt. Cases may be stacked, separated by blank lines.
  */
-class board {
-#define TASK_GREEDY       1
-#define TASK_MINIMAX      2
-#define TASK_ALPHA_BETA   3
-#define TASK_COMPETITION  4
-    
-#define OUTPUT_WIDTH 5
+struct input_case {
+    int task, who, cutoff, man1, man2;
+    double time_remain;
+    vector <int> p1, p2;
+};
+
+inline bool read_case(istream &fin, input_case &c) {
+    c.time_remain = 0;
+    c.cutoff = 1;
+    if (!(fin >> c.task >> c.who)) {
+        return false;
+    }
+    if (c.task == 4 || c.task == 5) {
+        //Competition, also by MCTS
+        fin >> c.time_remain;
+    } else {
+        fin >> c.cutoff;
+    }
+
+    string line;
+    getline(fin, line);             //consuming the line
+
+    c.p1.clear();
+    c.p2.clear();
+    getline(fin, line);             //player2
+    line_tokenization(line, c.p2);
+
+    getline(fin, line);             //player1
+    line_tokenization(line, c.p1);
+
+    fin >> c.man2 >> c.man1;
+    return !fin.fail();
+}
+
+#define MAX_PIT 10              //Board size: 3 ~ 10 pits per side
+#define MAX_POS (MAX_PIT << 1)
+#define MAX_PLY 128             //Search stack limit (in moves, not in depth)
+#define QUIESCE_NODES 64        //Quiescence budget per horizon node
+#define LMR_MOVES 3             //Moves searched in full before late move reductions
+#define LMR_DEPTH 2             //Turns left to the horizon for a reduction
+#define FUTILITY_MARGIN 2       //Evaluation units a leaf may gain over its evaluation
+#define RAZOR_MARGIN 8          //Below alpha by this much, two turns from the horizon, a node is razored
+#define MAX_DEPTH 64            //Iterative deepening limit
+#define ASPIRATION_WINDOW 10    //Root window around the last iteration's value
 #define MIN_INT -2147483648
 #define MAX_INT 2147483647
-
-#define WINNING 2147483646
+#define WINNING 2147483646      //Evaluation of a decided game
 #define LOSING -2147483646
 
-private:
-    enum player{player1 = 1, player2 = 2};
-    enum node{MAX_NODE = 0, MIN_NODE = 1};
-    player who;             //Who TO move!
-    player whom;            //From whom!
+#ifndef SEARCH_STATS            //-DSEARCH_STATS=0 compiles the counters out
+#define SEARCH_STATS 1
+#endif
+#define STAT(x) do { if (SEARCH_STATS && info.collect) { x; } } while (0)
+
+#ifndef CHECK_TOTALS            //-DCHECK_TOTALS=1 recounts the side totals after every move
+#define CHECK_TOTALS 0
+#endif
+
+/*
+ Zobrist keys. Pit contents are unbounded, so instead of a random table
+ the key of (square, stones) is a splitmix64 hash. Squares MAX_POS and
+ MAX_POS + 1 are the mancalas of player 1 and 2.
+ */
+#define ZOBRIST_SIDE 0x2545F4914F6CDD1DULL
+
+inline uint64_t zobrist(const int i, const int c) {
+    uint64_t z = ((uint64_t) i << 32 | (uint32_t) c) + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/*
+ Compact position used by the search.
+ Trivially copyable, no heap. Same index layout as the board:
+ 9 8 7 6 5
+ 0 1 2 3 4
+ */
+struct state {
+    int pit[MAX_POS];
     int man1, man2;         //Player's mancalas
     int n;                  //Board size
-    int m;                  //Total size (n * 2)
-    int task;               //The task to make the move
-    int cutoff;             //Search cutoff depth
-    int val;                //Minimax val
+    int who;                //Who TO move! (1 or 2)
+    int whom;               //From whom!
     int last_move;          //Last move  -1 means root
-    bool is_root;           //Is this a root node?
-    int alpha, beta;
-    vector <int> history;   //How we get here? Only modified by MINIMAX
-    vector <int> position;  //Position
-    vector <int> candidate; //Candidate move
+    uint64_t hash;          //Zobrist hash, kept up to date by play()
+    int stones[3];          //Stones in each player's pits, kept up to date by play()
+
+    int size() const {
+        return n << 1;
+    }
     /*
-     Example of the position index:
-     9 8 7 6 5
-     0 1 2 3 4
+     The move generator and the evaluation take the board size as a
+     template argument N, so that loop bounds and the wrap around the board
+     are constants. N = 0 is any size, read from n.
      */
-public:
-    board() {
+    template <int N>
+    int pits() const {
+        return N? N: n;
     }
-    board(const int task1, const int cutoff1, const int who1, const vector <int> &p2, const vector <int> &p1, const int m2, const int m1) {
-        
-        assert(!p1.empty() && !p2.empty() && p1.size() == p1.size());
-        
-        
-        alpha = MIN_INT;
-        beta = MAX_INT;
-        
-        is_root = true;
-        last_move = -1;
-        task = task1;
-        cutoff = cutoff1;
-        n = (int) p1.size();
-        m = n << 1;
-        position = vector <int> (m);
-
-
-
-        
-
-        if (who1 == 1) {
-            who = player1;
-            whom = player2;
+    bool is_own_pit(const int k) const {
+        if (who == 1) {
+            return k < n;
         } else {
-            who = player2;
-            whom = player1;
-        }
-        
-        man1 = m1; man2 = m2;
-        
-        //Initializing the board
-        for (int i = 0; i < n; ++i) {           //Player 1
-            position[i] = p1[i];
-        }
-        for (int i = n - 1; i >= 0; --i) {
-            position[m - 1 - i] = p2[i];
-        }
-
-
-        if (task == TASK_GREEDY) {
-            cutoff = 1;
-        } else if (task == TASK_COMPETITION) {
-            cutoff = compute_cutoff(n, accumulate(position.begin(), position.end(), 0));
+            return k >= n;
         }
-
-        update_candidate();
-        assert(!game_over());
     }
-    
-    int compute_cutoff(const int n, const int tot) const {      //size, total on board
-        /*
-            n: 3 ~ 10
-            tot: 1 ~ 10000
-        */
-
-        return (int) round(12 - sqrt(n) - log(tot) / log(15));
+    int side(const int p) const {                       //Stones on p's side
+        return stones[p];
     }
-
-
-    friend inline ostream &operator<<(ostream &out, const board &my_board) {
-        //print the position
-        //return out << my_board.position;
-        int n = my_board.n;
-        int m = my_board.m;
-        out << my_board.man2 << endl;
-        for (int i = m - 1; i >= n + 1; --i) {
-            out << setw(OUTPUT_WIDTH) << my_board.position[i];
+    template <int N = 0>
+    int count_side(const int p) const {                 //From scratch
+        int n = pits<N>(), m = n << 1;
+        int tot = 0;
+        for (int i = (p == 1)? 0: n, e = (p == 1)? n: m; i < e; ++i) {
+            tot += pit[i];
         }
-        out << setw(OUTPUT_WIDTH) << my_board.position[n] << endl;
-        for (int i = 0; i < n - 1; ++i) {
-            out << setw(OUTPUT_WIDTH) << my_board.position[i];
+        return tot;
+    }
+    void count_sides() {                                //After the pits are set by hand
+        stones[0] = 0;
+        stones[1] = count_side(1);
+        stones[2] = count_side(2);
+    }
+    bool game_over() const {
+        return side(1) == 0 || side(2) == 0;
+    }
+    template <int N = 0>
+    void end_game_collect() {
+        if (game_over()) {
+            man1 += side(1);
+            man2 += side(2);
+            for (int i = 0; i < (pits<N>() << 1); ++i) {
+                pit[i] = 0;
+            }
+            stones[1] = stones[2] = 0;
+            compute_hash();
         }
-        out << setw(OUTPUT_WIDTH) << my_board.position[n-1];
-        out << endl << setw(OUTPUT_WIDTH * (n + 1)) << my_board.man1;
-        
-        
-        out << endl << "Player " << my_board.who << " to move";
-        out << endl << "Cutoff depth: " << my_board.cutoff;
-        int current_eval = my_board.eval();
-        out << endl << "Position analysis: " << ((current_eval >= 0)? "+": "") << current_eval;
-        current_eval = my_board.eval(my_board.who);
-        out << endl << "Candidate move: " << my_board.candidate << "; " << my_board.get_pit_name(my_board.candidate);
-        out << endl << "----------------";
-        return out;
     }
-    inline string to_str() const {                //The output
-        string ret = "";
-        for (int i = m - 1; i >= n + 1; --i) {
-            ret += to_string(position[i]) + " ";
+    void compute_hash() {                               //From scratch
+        hash = zobrist(MAX_POS, man1) ^ zobrist(MAX_POS + 1, man2);
+        for (int i = 0; i < size(); ++i) {
+            hash ^= zobrist(i, pit[i]);
         }
-        ret += to_string(position[n]) + "\n";
-        for (int i = 0; i < n - 1; ++i) {
-            ret += to_string(position[i]) + " ";
+        if (who == 2) {
+            hash ^= ZOBRIST_SIDE;
         }
-        ret += to_string(position[n-1]) + "\n" + to_string(man2) + "\n" + to_string(man1);
-        return ret;
     }
-    
-    int size() const {
-        return n;
+    template <int N = 0>
+    bool extra_turn(const int k) const {                //Last stone of pit k in own mancala?
+        return extra_turn<N>(k, who);
     }
-    int turn() const {
-        return who;
+    template <int N = 0>
+    bool extra_turn(const int k, const int p) const {   //The same for player p's pit k
+        int n = pits<N>(), m = n << 1;
+        return pit[k] % (m + 1) == ((p == 1)? n: m) - k;
     }
-    const vector<int> &get_candidate() const {
-        return candidate;
+    template <int N = 0>
+    int capture(const int k) const {                    //Stones won by a capture from pit k, 0 if none
+        return capture<N>(k, who);
+    }
+    template <int N = 0>
+    int capture(const int k, const int p) const {       //The same for player p's pit k
+        int n = pits<N>(), m = n << 1;
+        int s = pit[k];
+        int run = ((p == 1)? n: m) - 1 - k;            //Own pits after k
+        if (s > m + 1 || s == run + 1) {
+            return 0;
+        }
+        if (s == m + 1) {                               //One full lap, back into the emptied pit
+            return 2 + pit[m-k-1];
+        }
+        bool wrapped = s > run;                         //Past our mancala and every opponent's pit
+        int j = wrapped? ((p == 1)? n: m) + s - run - 2: k + s;
+        j = (j < m)? j: j - m;
+        if (((p == 1)? j >= n: j < n) || pit[j] != 0) {
+            return 0;
+        }
+        return 1 + pit[m-j-1] + wrapped;                //The opposite pit got one on the way
     }
-    const vector<int> &get_position() const {
-        return position;
+    template <int N = 0>
+    int candidates(int *out) const {                   //Legal moves, highest pit first
+        int n = pits<N>();
+        int c = 0;
+        if (who == 1) {
+            for (int k = n - 1; k >= 0; --k) {
+                if (pit[k] > 0)
+                    out[c++] = k;
+            }
+        } else {
+            for (int k = (n << 1) - 1; k >= n; --k) {
+                if (pit[k] > 0)
+                    out[c++] = k;
+            }
+        }
+        return c;
     }
+    /*
+     Choose the k th pit. Sowing goes by whole laps: a lap of m + 1 stones
+     puts one in every pit (k included) and one in our mancala, then the
+     remainder runs from k + 1, through our mancala, on to the rest.
+     */
+    template <int N = 0>
+    void play(const int k) {
+        assert(is_own_pit(k) && pit[k] > 0);
+        int n = pits<N>(), m = n << 1;
+        whom = who;
+        last_move = k;
+        int tot = pit[k];
+        int span = min(tot, m - 1);         //Pits touched after k
+        hash ^= zobrist(MAX_POS, man1) ^ zobrist(MAX_POS + 1, man2);
+        for (int j = 0, p = k; j <= span; ++j, p = (p + 1 == m)? 0: p + 1) {
+            hash ^= zobrist(p, pit[p]);
+        }
+        int &mancala = (who == 1)? man1: man2;
+        int opp = 3 - who;
+        int to_mancala = ((who == 1)? n: m) - k;       //Stones up to our mancala
+        int laps = tot / (m + 1), rem = tot % (m + 1);
+        pit[k] = 0;
+        stones[who] -= tot;
+        if (laps) {
+            for (int p = 0; p < m; ++p) {
+                pit[p] += laps;
+            }
+            mancala += laps;
+            stones[1] += laps * n;
+            stones[2] += laps * n;
+        }
+        int before = min(rem, to_mancala - 1);         //Own pits before our mancala
+        for (int j = 1; j <= before; ++j) {
+            ++pit[k + j];
+        }
+        stones[who] += before;
+        if (rem >= to_mancala) {
+            ++mancala;
+            for (int j = to_mancala, p = k + j; j < rem; ++j, ++p) {
+                ++pit[(p < m)? p: p - m];
+            }
+            int after = rem - to_mancala;               //Opponent's pits first
+            stones[opp] += min(after, n);
+            stones[who] += after - min(after, n);
+        }
+        int drop = rem? rem: m + 1;                     //Where the last stone goes
+        bool last = drop == to_mancala;    //Fall into own mancala?
+        int i = (drop < to_mancala)? k + drop: k + drop - 1;
+        i = (i < m)? i: i - m;
 
-    board move(vector <string> &history_moves, vector <string> &traverse_log, const bool save_log = true) const { //NOT a mutator!
-        //assert(has_legal_move());
-        assert(!game_over());
-        
-        vector<string> the_move;
-        board next;
-        switch (task) {
-            case TASK_GREEDY:
-                next = move_minimax(history_moves, traverse_log, false, save_log);
-                return next;
-            case TASK_MINIMAX:
-                next = move_minimax(history_moves, traverse_log, false, save_log);
-                return next;
-            case TASK_ALPHA_BETA:
-                next = move_minimax(history_moves, traverse_log, true, save_log);
-                return next;
-            case TASK_COMPETITION:
-                next = move_minimax(history_moves, traverse_log, true, save_log);
-                return next;
-            default:
-                return *this;
+        for (int j = 0, p = k; j <= span; ++j, p = (p + 1 == m)? 0: p + 1) {
+            hash ^= zobrist(p, pit[p]);
         }
-        
+
+        if (!last) {    //Not in own mancala
+            //If end up in own zero pit, capture this (i) and the opposite (m-i-1)
+            if (((who == 1)? i < n: i >= n) && pit[i] == 1) {
+                int tmp = pit[i] + pit[m-i-1];
+                if (who == 1) {
+                    man1 += tmp;
+                } else {
+                    man2 += tmp;
+                }
+                hash ^= zobrist(i, pit[i]) ^ zobrist(i, 0);
+                hash ^= zobrist(m-i-1, pit[m-i-1]) ^ zobrist(m-i-1, 0);
+                stones[who] -= pit[i];
+                stones[opp] -= pit[m-i-1];
+                pit[i] = pit[m-i-1] = 0;
+            }
+            //If NOT end up in own mancala, FLIP
+            who = (who == 1)? 2: 1;
+            hash ^= ZOBRIST_SIDE;
+        }
+        hash ^= zobrist(MAX_POS, man1) ^ zobrist(MAX_POS + 1, man2);
+        if (CHECK_TOTALS) {
+            assert(stones[1] == count_side(1) && stones[2] == count_side(2));
+        }
+        end_game_collect<N>();
     }
-    
-    board move(const int k) const {                    //Choose the k th pit
-        assert(is_own_pit(k) && position[k] > 0);
-        board t = *this;
-        t.whom = who;
-        t.last_move = k;
-        t.is_root = false;
+    void play_reference(const int k) {                  //Stone by stone, to check play()
+        assert(is_own_pit(k) && pit[k] > 0);
+        int m = size();
+        whom = who;
+        last_move = k;
         //Move
         int i = (k + 1) % m;              //next pos
         bool last = false;          //Fall into own mancala?
-        int tot = t.position[k];
-        t.position[k] = 0;
+        int tot = pit[k];
+        int span = min(tot, m - 1);         //Pits touched after k
+        hash ^= zobrist(MAX_POS, man1) ^ zobrist(MAX_POS + 1, man2);
+        for (int j = 0, p = k; j <= span; ++j, p = (p + 1 == m)? 0: p + 1) {
+            hash ^= zobrist(p, pit[p]);
+        }
+        pit[k] = 0;
         while (tot--) {
-            if (who == player1) {
+            if (who == 1) {
                 if (!last && i == n) {
                     last = true;
-                    ++t.man1;
+                    ++man1;
                 } else {
-                    ++t.position[i];
+                    ++pit[i];
                     i = (i + 1) % m;
                     last = false;
                 }
             } else {
                 if (!last && i == 0) {
                     last = true;
-                    ++t.man2;
+                    ++man2;
                 } else {
-                    ++t.position[i];
+                    ++pit[i];
                     i = (i + 1) % m;
                     last = false;
                 }
             }
-        }
-        
-        
-        if (!last) {    //Not in own mancala
-            
-            //If end up in own zero pit, capture this (i) and the opposite (m-i-1)
-            
-            /*
-             CAPTURE!!!!!
-             */
-            i = (i - 1 + m) % m;
-            //cout << "Last: " << get_pit_name(i) << " " << i << endl;
-            //cout << t.position << endl;
-            if (is_own_pit(i) && t.position[i] == 1/* && t.position[m-i-1] > 0*/) {
-                int tmp = t.position[i] + t.position[m-i-1];
-                if (who == player1) {
-                    t.man1 += tmp;
-                } else {
-                    t.man2 += tmp;
-                }
-                t.position[i] = t.position[m-i-1] = 0;
+        }
+
+        for (int j = 0, p = k; j <= span; ++j, p = (p + 1 == m)? 0: p + 1) {
+            hash ^= zobrist(p, pit[p]);
+        }
+
+        if (!last) {    //Not in own mancala
+            //If end up in own zero pit, capture this (i) and the opposite (m-i-1)
+            i = (i - 1 + m) % m;
+            if (is_own_pit(i) && pit[i] == 1) {
+                int tmp = pit[i] + pit[m-i-1];
+                if (who == 1) {
+                    man1 += tmp;
+                } else {
+                    man2 += tmp;
+                }
+                hash ^= zobrist(i, pit[i]) ^ zobrist(i, 0);
+                hash ^= zobrist(m-i-1, pit[m-i-1]) ^ zobrist(m-i-1, 0);
+                pit[i] = pit[m-i-1] = 0;
+            }
+            //If NOT end up in own mancala, FLIP
+            who = (who == 1)? 2: 1;
+            hash ^= ZOBRIST_SIDE;
+        }
+        hash ^= zobrist(MAX_POS, man1) ^ zobrist(MAX_POS + 1, man2);
+        count_sides();
+        end_game_collect();
+    }
+};
+
+/*
+ Transposition table: fixed size, power of two, one entry per slot.
+ Values are stored from the side to move's perspective, draft is the
+ remaining search depth (an extra turn counts as one more).
+ Lock-free: a slot is two relaxed atomic words and the key word holds
+ key ^ data, so a torn write from another thread fails the key check.
+ Every search bumps the generation, so a table kept from move to move
+ (server, host, tournament) lets new entries replace a deep old one.
+ */
+#define BOUND_EXACT 0
+#define BOUND_LOWER 1
+#define BOUND_UPPER 2
+
+#define REPLACE_ALWAYS 0            //Newest entry wins
+#define REPLACE_DEPTH  1            //Keep the deeper entry of a slot, from this search
+
+struct tt_entry {
+    int value;
+    int draft;                      //-1 means empty
+    int bound;
+    int move;
+    int gen;                        //Generation of the search that stored it
+};
+
+struct tt_stats {                   //Per search thread, summed for the report
+    long long probes, hits, misses, collisions, cutoffs, stores;
+
+    tt_stats() {
+        probes = hits = misses = collisions = cutoffs = stores = 0;
+    }
+    tt_stats &operator+=(const tt_stats &o) {
+        probes += o.probes; hits += o.hits; misses += o.misses;
+        collisions += o.collisions; cutoffs += o.cutoffs; stores += o.stores;
+        return *this;
+    }
+    friend inline ostream &operator<<(ostream &out, const tt_stats &st) {
+        out << "TT: probes " << st.probes << ", hits " << st.hits
+            << ", misses " << st.misses << ", collisions " << st.collisions
+            << ", cutoffs " << st.cutoffs << ", stores " << st.stores;
+        if (st.probes) {
+            out << ", hit rate " << fixed << setprecision(1) << 100.0 * st.hits / st.probes << "%";
+            out.unsetf(ios::fixed);
+        }
+        return out;
+    }
+};
+
+class trans_table {
+private:
+    struct slot {
+        atomic <uint64_t> key;      //key ^ data
+        atomic <uint64_t> data;
+    };
+    unique_ptr <slot[]> table;
+    size_t cnt;
+    uint64_t mask;
+    int policy;
+    atomic <unsigned> generation;   //Low 8 bits are stored
+
+    static uint64_t pack(const tt_entry &e) {
+        return (uint64_t) (uint32_t) e.value | (uint64_t) (uint8_t) (e.draft + 1) << 32
+            | (uint64_t) (uint8_t) e.bound << 40 | (uint64_t) (uint8_t) e.move << 48 | (uint64_t) (uint8_t) e.gen << 56;
+    }
+    static tt_entry unpack(const uint64_t d) {
+        tt_entry e;
+        e.value = (int) (uint32_t) d;
+        e.draft = (int) (uint8_t) (d >> 32) - 1;
+        e.bound = (uint8_t) (d >> 40);
+        e.move = (int8_t) (d >> 48);
+        e.gen = (uint8_t) (d >> 56);
+        return e;
+    }
+public:
+    trans_table(const size_t mb = 0, const int policy1 = REPLACE_DEPTH) {
+        policy = policy1;
+        generation = 0;
+        resize(mb);
+    }
+    void resize(const size_t mb) {                      //Largest power of two within mb MiB
+        cnt = 0;
+        if (mb > 0) {
+            cnt = 1;
+            while ((cnt << 1) * sizeof(slot) <= (mb << 20)) {
+                cnt <<= 1;
+            }
+        }
+        table.reset(cnt? new slot[cnt]: nullptr);
+        mask = cnt? cnt - 1: 0;
+        clear();
+    }
+    void clear() {
+        for (size_t i = 0; i < cnt; ++i) {
+            table[i].key.store(0, memory_order_relaxed);
+            table[i].data.store(0, memory_order_relaxed);
+        }
+    }
+    void new_search() {                                 //Entries stored so far become old
+        ++generation;
+    }
+    bool enabled() const {
+        return cnt > 0;
+    }
+    size_t size() const {
+        return cnt;
+    }
+    bool probe(const uint64_t key, tt_entry &e, tt_stats &st) const {
+        const slot &s = table[key & mask];
+        uint64_t d = s.data.load(memory_order_relaxed);
+        uint64_t k = s.key.load(memory_order_relaxed) ^ d;
+        ++st.probes;
+        e = unpack(d);
+        if (e.draft >= 0 && k == key) {
+            ++st.hits;
+            return true;
+        }
+        ++st.misses;
+        if (e.draft >= 0) {
+            ++st.collisions;
+        }
+        return false;
+    }
+    void store(const uint64_t key, const int draft, const int value, const int bound, const int move, tt_stats &st) {
+        slot &s = table[key & mask];
+        if (policy == REPLACE_DEPTH) {
+            uint64_t d = s.data.load(memory_order_relaxed);
+            tt_entry old = unpack(d);
+            if (old.draft > draft && old.gen == (uint8_t) generation && (s.key.load(memory_order_relaxed) ^ d) != key) {
+                return;
+            }
+        }
+        tt_entry e = {value, draft, bound, move, (int) (uint8_t) generation};
+        uint64_t d = pack(e);
+        s.key.store(key ^ d, memory_order_relaxed);
+        s.data.store(d, memory_order_relaxed);
+        ++st.stores;
+    }
+};
+
+/*
+ A file mapped read-only into memory, unmapped when closed or destroyed.
+ The endgame database, the opening book and binary positions are all
+ read in place through one.
+ */
+class mapped_file {
+private:
+    const unsigned char *base;
+    size_t bytes;
+
+public:
+    mapped_file() : base(nullptr), bytes(0) {
+    }
+    mapped_file(const mapped_file &) = delete;      //One owner of the mapping
+    mapped_file &operator=(const mapped_file &) = delete;
+    ~mapped_file() {
+        close();
+    }
+    bool open(const string &file, const size_t min_size, const int advice) {    //advice: MADV_RANDOM, MADV_SEQUENTIAL...
+        close();
+        int fd = ::open(file.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        void *p = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && st.st_size > 0 && (size_t) st.st_size >= min_size) {
+            p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            return false;
+        }
+        base = (const unsigned char *) p;
+        bytes = st.st_size;
+        madvise(p, bytes, advice);
+        return true;
+    }
+    void close() {
+        if (base) {
+            munmap((void *) base, bytes);
+        }
+        base = nullptr;
+        bytes = 0;
+    }
+    const unsigned char *data() const {
+        return base;
+    }
+    size_t size() const {
+        return bytes;
+    }
+};
+
+/*
+ Endgame database. In Kalah only the stones still on the board are in
+ play, so for every position with at most limit[n] of them it keeps how
+ many the side to move ends up with under perfect play. A position is
+ stored as seen by the side to move (rotated to player 1) and ranked in
+ the combinatorial number system, layer by layer of stone count, so a
+ probe is one rank and one byte read from the memory-mapped file.
+ File: "MEGB", version, then for board sizes 0 ~ MAX_PIT the stone limit
+ (int32, 0 = no table) and the table offset (uint64), then the tables.
+ */
+#define EGDB_VERSION 1
+#define EGDB_MAX_STONES 64
+#define EGDB_MAX_MB 64              //Per board size
+#define EGDB_UNKNOWN 0xFF
+
+struct binomial_table {
+    uint64_t c[EGDB_MAX_STONES + MAX_POS + 1][MAX_POS + 1];
+
+    binomial_table() {
+        for (int x = 0; x <= EGDB_MAX_STONES + MAX_POS; ++x) {
+            for (int y = 0; y <= MAX_POS; ++y) {
+                c[x][y] = (y == 0)? 1: (x == 0)? 0: c[x-1][y-1] + c[x-1][y];
+            }
+        }
+    }
+};
+
+inline uint64_t choose(const int x, const int y) {
+    static const binomial_table t;
+    return t.c[x][y];
+}
+
+class endgame_db {
+private:
+    mapped_file mapped;
+    int limit[MAX_PIT + 1];
+    uint64_t offset[MAX_PIT + 1];
+
+    static size_t header_size() {
+        return 8 + (MAX_PIT + 1) * (sizeof(int32_t) + sizeof(uint64_t));
+    }
+    static uint64_t table_size(const int stones, const int m) {    //Positions with up to stones
+        return choose(stones + m, m);
+    }
+    static uint64_t rank(const int *a, const int stones, const int m) {
+        uint64_t idx = stones? choose(stones - 1 + m, m): 0;           //Lower layers first
+        int r = stones;
+        for (int i = 0, k = m - 2; k >= 0; ++i, --k) {              //Positions with a smaller a[i]
+            idx += choose(r + k + 1, k + 1) - choose(r - a[i] + k + 1, k + 1);
+            r -= a[i];
+        }
+        return idx;
+    }
+    static void unrank(uint64_t idx, const int stones, const int m, int *a) {   //idx within the layer
+        int r = stones;
+        for (int i = 0, k = m - 2; k >= 0; ++i, --k) {
+            int v = 0;
+            while (idx >= choose(r - v + k, k)) {
+                idx -= choose(r - v + k, k);
+                ++v;
+            }
+            a[i] = v;
+            r -= v;
+        }
+        a[m - 1] = r;
+    }
+    static void rotate_to(const state &s, int *a) {                 //Side to move as player 1
+        int m = s.size();
+        int r = (s.who == 1)? 0: s.n;
+        for (int i = 0; i < m; ++i) {
+            a[i] = s.pit[(i + r < m)? i + r: i + r - m];
+        }
+    }
+    /*
+     Stones won from a position of player 1 to move with empty mancalas.
+     Lower layers are complete, and a move that keeps every stone on the
+     board only moves the mover's stones towards the mover's mancala, so the
+     recursion within a layer always terminates.
+     */
+    static int solve(vector <unsigned char> &val, const int n, const int *a, const int stones) {
+        int m = n << 1;
+        uint64_t idx = rank(a, stones, m);
+        if (val[idx] != EGDB_UNKNOWN) {
+            return val[idx];
+        }
+        state s;
+        s.n = n;
+        s.who = 1;
+        s.whom = 2;
+        s.man1 = s.man2 = 0;
+        s.last_move = -1;
+        s.hash = 0;
+        copy(a, a + m, s.pit);
+        s.count_sides();
+        int best = s.side(1);
+        if (!s.game_over()) {
+            best = 0;
+            for (int k = 0; k < n; ++k) {
+                if (s.pit[k] == 0) {
+                    continue;
+                }
+                state t = s;
+                t.play(k);
+                int g = t.man1;
+                if (!t.game_over()) {
+                    int rest = stones - t.man1, b[MAX_POS];
+                    rotate_to(t, b);
+                    int h = solve(val, n, b, rest);
+                    g += (t.who == 1)? h: rest - h;
+                }
+                best = max(best, g);
+            }
+        }
+        val[idx] = (unsigned char) best;
+        return best;
+    }
+
+public:
+    endgame_db() {
+        for (int n = 0; n <= MAX_PIT; ++n) {
+            limit[n] = 0;
+            offset[n] = 0;
+        }
+    }
+    ~endgame_db() {
+        close();
+    }
+    bool open(const string &file) {
+        close();
+        if (!mapped.open(file, header_size(), MADV_RANDOM)) {
+            return false;
+        }
+        const unsigned char *data = mapped.data();
+        int32_t version;
+        memcpy(&version, data + 4, sizeof(version));
+        bool ok = memcmp(data, "MEGB", 4) == 0 && version == EGDB_VERSION;
+        for (int n = 0, at = 8; n <= MAX_PIT && ok; ++n) {
+            int32_t lim;
+            memcpy(&lim, data + at, sizeof(lim));
+            memcpy(&offset[n], data + at + sizeof(lim), sizeof(uint64_t));
+            at += sizeof(lim) + sizeof(uint64_t);
+            limit[n] = lim;
+            ok = lim == 0 || (n >= 3 && lim <= EGDB_MAX_STONES && offset[n] + table_size(lim, n << 1) <= mapped.size());
+        }
+        if (!ok) {
+            close();
+            return false;
+        }
+        return true;
+    }
+    void close() {
+        mapped.close();
+        for (int n = 0; n <= MAX_PIT; ++n) {
+            limit[n] = 0;
+        }
+    }
+    int stones(const int n) const {                     //Stone limit of board size n, 0 if none
+        return limit[n];
+    }
+    bool covers(const state &s) const {
+        return limit[s.n] && s.side(1) + s.side(2) <= limit[s.n];
+    }
+    bool probe(const state &s, int &margin) const {     //Final man1 - man2 under perfect play
+        if (!covers(s)) {
+            return false;
+        }
+        int m = s.size(), a[MAX_POS];
+        int left = s.side(1) + s.side(2);
+        rotate_to(s, a);
+        int g = mapped.data()[offset[s.n] + rank(a, left, m)];
+        int won = (s.who == 1)? g: left - g;          //By player 1
+        margin = s.man1 + won - s.man2 - (left - won);
+        return true;
+    }
+    /*
+     Offline generator: every board size with up to stones on the board,
+     fewer where the table would exceed EGDB_MAX_MB.
+     */
+    static bool build(const string &file, const int stones, ostream &log) {
+        int lim[MAX_PIT + 1];
+        uint64_t off[MAX_PIT + 1];
+        uint64_t at = header_size();
+        for (int n = 0; n <= MAX_PIT; ++n) {
+            lim[n] = 0;
+            off[n] = 0;
+            if (n < 3) {
+                continue;
+            }
+            lim[n] = min(stones, EGDB_MAX_STONES);
+            while (lim[n] > 0 && table_size(lim[n], n << 1) > ((uint64_t) EGDB_MAX_MB << 20)) {
+                --lim[n];
+            }
+            off[n] = at;
+            at += lim[n]? table_size(lim[n], n << 1): 0;
+        }
+        ofstream out(file, ios::out | ios::binary);
+        int32_t version = EGDB_VERSION;
+        out.write("MEGB", 4);
+        out.write((const char *) &version, sizeof(version));
+        for (int n = 0; n <= MAX_PIT; ++n) {
+            int32_t l = lim[n];
+            out.write((const char *) &l, sizeof(l));
+            out.write((const char *) &off[n], sizeof(off[n]));
+        }
+        for (int n = 3; n <= MAX_PIT; ++n) {
+            if (!lim[n]) {
+                continue;
+            }
+            int m = n << 1, a[MAX_POS];
+            vector <unsigned char> val(table_size(lim[n], m), EGDB_UNKNOWN);
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            for (int s = 0; s <= lim[n]; ++s) {
+                for (uint64_t j = 0, c = choose(s + m - 1, m - 1); j < c; ++j) {
+                    unrank(j, s, m, a);
+                    solve(val, n, a, s);
+                }
+            }
+            out.write((const char *) val.data(), val.size());
+            log << n << " pits: up to " << lim[n] << " stones, " << val.size() << " positions, "
+                << fixed << setprecision(1) << chrono::duration<double>(chrono::steady_clock::now() - start).count() << "s" << endl;
+            log.unsetf(ios::fixed);
+        }
+        out.close();
+        return !out.fail();
+    }
+};
+
+/*
+ Opening book: the first pit and the value of positions near the standard
+ starts, searched deep offline (see build_book). The records are sorted
+ by hash and used in place from the memory-mapped file, so opening costs
+ one mmap and a probe is a binary search.
+ File: "MBOK", version, record count (uint64), then the records.
+ */
+#define BOOK_VERSION 1
+
+struct book_entry {
+    uint64_t hash;
+    int32_t value;                  //Side to move's view
+    int16_t depth;
+    int8_t n;                       //Board size, the hash does not tell
+    int8_t pit;
+};
+
+class opening_book {
+private:
+    mapped_file mapped;
+    const book_entry *entries;
+    uint64_t count;
+
+    static size_t header_size() {
+        return 8 + sizeof(uint64_t);
+    }
+
+public:
+    opening_book() : entries(nullptr), count(0) {
+    }
+    ~opening_book() {
+        close();
+    }
+    bool open(const string &file) {
+        close();
+        if (!mapped.open(file, header_size(), MADV_RANDOM)) {
+            return false;
+        }
+        const unsigned char *data = mapped.data();
+        int32_t version;
+        memcpy(&version, data + 4, sizeof(version));
+        memcpy(&count, data + 8, sizeof(count));
+        if (memcmp(data, "MBOK", 4) != 0 || version != BOOK_VERSION || header_size() + count * sizeof(book_entry) != mapped.size()) {
+            close();
+            return false;
+        }
+        entries = (const book_entry *) (data + header_size());
+        return true;
+    }
+    void close() {
+        mapped.close();
+        entries = nullptr;
+        count = 0;
+    }
+    uint64_t size() const {
+        return count;
+    }
+    bool probe(const state &s, book_entry &e) const {
+        const book_entry *end = entries + count;
+        const book_entry *it = lower_bound(entries, end, s.hash, [](const book_entry &a, const uint64_t h) {
+            return a.hash < h;
+        });
+        for (; it != end && it->hash == s.hash; ++it) {
+            if (it->n == s.n) {
+                e = *it;
+                return true;
+            }
+        }
+        return false;
+    }
+    static bool write(const string &file, vector <book_entry> records) {
+        sort(records.begin(), records.end(), [](const book_entry &a, const book_entry &b) {
+            return a.hash < b.hash || (a.hash == b.hash && a.n < b.n);
+        });
+        ofstream out(file, ios::out | ios::binary);
+        int32_t version = BOOK_VERSION;
+        uint64_t count = records.size();
+        out.write("MBOK", 4);
+        out.write((const char *) &version, sizeof(version));
+        out.write((const char *) &count, sizeof(count));
+        out.write((const char *) records.data(), records.size() * sizeof(book_entry));
+        out.close();
+        return !out.fail();
+    }
+};
+
+/*
+ Binary positions: fixed 64-byte little-endian records, for suites of
+ test cases, tuning data and game records too large to parse as text.
+ File: "MPOS", version, record size, then the records; the count
+ follows from the file size. The pits use the layout of state; the
+ records of one game are consecutive and share its id.
+ */
+#define RECORD_VERSION 1
+#define RECORD_MAX_STONES INT16_MAX     //Any count and final margin of such a board fits a record
+
+struct position_record {
+    uint8_t n;                      //Board size
+    uint8_t who;                    //Side to move, 1 or 2
+    int8_t best;                    //Best pit, -1 if unknown
+    uint8_t task;                   //Task of the input case, 0 if none
+    int32_t score;                  //Side to move's view, if best is known
+    uint32_t game;                  //Game id, 0 if not from a game
+    int16_t result;                 //man1 - man2 at the end of the game
+    uint16_t cutoff;                //Input case's cutoff depth
+    float time_remain;              //Input case's clock
+    uint16_t man1, man2;
+    uint16_t pit[MAX_POS];
+};
+static_assert(sizeof(position_record) == 64, "position_record is 64 bytes on disk");
+
+inline position_record make_record(const state &s) {
+    position_record r;
+    memset(&r, 0, sizeof(r));
+    r.n = s.n;
+    r.who = s.who;
+    r.best = -1;
+    r.man1 = s.man1;
+    r.man2 = s.man2;
+    for (int i = 0; i < s.size(); ++i) {
+        r.pit[i] = s.pit[i];
+    }
+    return r;
+}
+
+inline position_record make_record(const input_case &c) {
+    position_record r;
+    memset(&r, 0, sizeof(r));
+    int n = c.p1.size(), m = n << 1;
+    r.n = n;
+    r.who = c.who;
+    r.best = -1;
+    r.task = c.task;
+    r.cutoff = c.cutoff;
+    r.time_remain = c.time_remain;
+    r.man1 = c.man1;
+    r.man2 = c.man2;
+    for (int i = 0; i < n; ++i) {
+        r.pit[i] = c.p1[i];
+        r.pit[m - 1 - i] = c.p2[i];
+    }
+    return r;
+}
+
+inline bool record_fits(const input_case &c) {      //Every count fits its field of position_record
+    bool ok = c.task >= 0 && c.task <= UINT8_MAX && c.cutoff >= 0 && c.cutoff <= UINT16_MAX
+        && c.man1 >= 0 && c.man1 <= UINT16_MAX && c.man2 >= 0 && c.man2 <= UINT16_MAX;
+    for (size_t i = 0; i < c.p1.size() && ok; ++i) {
+        ok = c.p1[i] >= 0 && c.p1[i] <= UINT16_MAX && c.p2[i] >= 0 && c.p2[i] <= UINT16_MAX;
+    }
+    return ok;
+}
+
+inline state record_state(const position_record &r) {
+    state s;
+    s.n = r.n;
+    s.who = r.who;
+    s.whom = 3 - r.who;
+    s.last_move = -1;
+    s.man1 = r.man1;
+    s.man2 = r.man2;
+    for (int i = 0; i < s.size(); ++i) {
+        s.pit[i] = r.pit[i];
+    }
+    s.compute_hash();
+    s.count_sides();
+    return s;
+}
+
+inline input_case record_case(const position_record &r) {
+    input_case c;
+    int n = r.n, m = n << 1;
+    c.task = r.task? r.task: 4;
+    c.who = r.who;
+    c.cutoff = r.cutoff;
+    c.time_remain = r.time_remain;
+    c.man1 = r.man1;
+    c.man2 = r.man2;
+    for (int i = 0; i < n; ++i) {
+        c.p1.push_back(r.pit[i]);
+        c.p2.push_back(r.pit[m - 1 - i]);
+    }
+    return c;
+}
+
+class position_writer {
+private:
+    ofstream out;
+
+public:
+    position_writer(const string &file) : out(file, ios::out | ios::binary) {
+        int32_t version = RECORD_VERSION, bytes = sizeof(position_record);
+        out.write("MPOS", 4);
+        out.write((const char *) &version, sizeof(version));
+        out.write((const char *) &bytes, sizeof(bytes));
+    }
+    void write(const position_record &r) {
+        out.write((const char *) &r, sizeof(r));
+    }
+    bool close() {
+        out.close();
+        return !out.fail();
+    }
+};
+
+class position_file {
+private:
+    mapped_file mapped;
+    const position_record *records;
+    size_t count;
+
+    static size_t header_size() {
+        return 12;
+    }
+
+public:
+    position_file() : records(nullptr), count(0) {
+    }
+    ~position_file() {
+        close();
+    }
+    static bool is_binary(const string &file) {
+        char magic[4] = {0};
+        ifstream fin(file, ios::in | ios::binary);
+        fin.read(magic, 4);
+        return fin && memcmp(magic, "MPOS", 4) == 0;
+    }
+    bool open(const string &file) {
+        close();
+        if (!mapped.open(file, header_size(), MADV_SEQUENTIAL)) {
+            return false;
+        }
+        const unsigned char *data = mapped.data();
+        size_t bytes = mapped.size();
+        int32_t version, size;
+        memcpy(&version, data + 4, sizeof(version));
+        memcpy(&size, data + 8, sizeof(size));
+        if (memcmp(data, "MPOS", 4) != 0 || version != RECORD_VERSION || size != sizeof(position_record)
+            || (bytes - header_size()) % sizeof(position_record) != 0) {
+            close();
+            return false;
+        }
+        records = (const position_record *) (data + header_size());
+        count = (bytes - header_size()) / sizeof(position_record);
+        return true;
+    }
+    void close() {
+        mapped.close();
+        records = nullptr;
+        count = 0;
+    }
+    size_t size() const {
+        return count;
+    }
+    const position_record &operator[](const size_t i) const {
+        return records[i];
+    }
+};
+
+/*
+ Converter between input.txt cases and binary positions, either way: a
+ binary input is written out as text cases, anything else is read as
+ text cases and written as binary.
+ */
+inline int case_line(const string &file, const streamoff at) {     //Line of the case read from byte at on
+    ifstream fin(file);
+    int line = 1;
+    char ch;
+    for (streamoff i = 0; fin.get(ch) && (i < at || isspace(ch)); ++i) {
+        line += ch == '\n';
+    }
+    return line;
+}
+
+inline bool convert_records(const string &in_file, const string &out_file, ostream &log) {
+    size_t count = 0;
+    if (position_file::is_binary(in_file)) {
+        position_file in;
+        if (!in.open(in_file)) {
+            return false;
+        }
+        ofstream out(out_file);
+        for (size_t i = 0; i < in.size(); ++i, ++count) {
+            input_case c = record_case(in[i]);
+            out << (i? "\n": "") << c.task << "\n" << c.who << "\n";
+            if (c.task == 4 || c.task == 5) {
+                out << c.time_remain << "\n";
+            } else {
+                out << c.cutoff << "\n";
+            }
+            for (size_t k = 0; k < c.p2.size(); ++k) {
+                out << (k? " ": "") << c.p2[k];
+            }
+            out << "\n";
+            for (size_t k = 0; k < c.p1.size(); ++k) {
+                out << (k? " ": "") << c.p1[k];
+            }
+            out << "\n" << c.man2 << "\n" << c.man1 << "\n";
+        }
+        out.close();
+        log << count << " positions to text" << endl;
+        return !out.fail();
+    }
+    ifstream in(in_file);
+    if (!in) {
+        return false;
+    }
+    position_writer out(out_file);
+    input_case c;
+    for (streamoff at = in.tellg(); read_case(in, c); at = in.tellg()) {
+        if (c.p1.empty() || c.p1.size() != c.p2.size() || c.p1.size() > MAX_PIT) {
+            log << "Case " << count << " (line " << case_line(in_file, at) << "): bad board" << endl;
+            return false;
+        }
+        if (!record_fits(c)) {
+            log << "Case " << count << " (line " << case_line(in_file, at) << "): a count does not fit a binary record" << endl;
+            return false;
+        }
+        out.write(make_record(c));
+        ++count;
+    }
+    log << count << " positions to binary" << endl;
+    return out.close();
+}
+
+/*
+ Traverse log writer. Lines are formatted straight into a buffer, which
+ goes to the stream only when full and on flush, so logging a large tree
+ neither keeps it in memory nor costs a flush per node.
+ LOG_BINARY writes fixed-size little-endian records instead:
+ "MLOG", version, n, prune, has header line, then per node the move (int8, -1 = root),
+ depth (uint16), value and, if prune, alpha and beta (int32 each).
+ */
+#define LOG_TEXT    0
+#define LOG_BINARY  1
+#define LOG_VERSION 1
+
+class log_writer {
+private:
+    ostream &out;
+    int n, m;
+    bool prune;
+    int format;
+    size_t len;
+    char buf[1 << 16];
+
+    void put(const char c) {
+        buf[len++] = c;
+    }
+    void put(const char *t) {
+        while (*t) {
+            buf[len++] = *t++;
+        }
+    }
+    void put_int(const long long x) {
+        if (x == MIN_INT) {
+            put("-Infinity");
+            return;
+        }
+        if (x == MAX_INT) {
+            put("Infinity");
+            return;
+        }
+        char tmp[24];
+        int k = 0;
+        unsigned long long u = (x < 0)? -(unsigned long long) x: x;
+        do {
+            tmp[k++] = '0' + u % 10;
+            u /= 10;
+        } while (u);
+        if (x < 0) {
+            put('-');
+        }
+        while (k) {
+            put(tmp[--k]);
+        }
+    }
+    void put_name(const int k) {
+        if (k == -1) {
+            put("root");
+        } else if (k < n) {
+            put('B');
+            put_int(k + 2);
+        } else {
+            put('A');
+            put_int(m - k + 1);
+        }
+    }
+    void put_raw(const int64_t x, const int bytes) {
+        for (int i = 0; i < bytes; ++i) {
+            buf[len++] = (char) (x >> (i << 3));
+        }
+    }
+
+public:
+    log_writer(ostream &out1, const int n1, const bool prune1, const int format1 = LOG_TEXT) : out(out1), n(n1), m(n1 << 1), prune(prune1), format(format1), len(0) {
+        if (format == LOG_BINARY) {
+            put("MLOG");
+            put_raw(LOG_VERSION, 1);
+            put_raw(n, 1);
+            put_raw(prune, 1);
+            put_raw(0, 1);
+        }
+    }
+    ~log_writer() {
+        flush();
+    }
+    void header(const char *line) {         //Before any node
+        if (format == LOG_BINARY) {
+            buf[7] = 1;
+            return;
+        }
+        put(line);
+        put('\n');
+    }
+    void record(const int k, const int depth, const int val, const int alpha, const int beta) {
+        if (len + 80 > sizeof(buf)) {
+            flush();
+        }
+        if (format == LOG_BINARY) {
+            put_raw(k, 1);
+            put_raw(depth, 2);
+            put_raw(val, 4);
+            if (prune) {
+                put_raw(alpha, 4);
+                put_raw(beta, 4);
+            }
+            return;
+        }
+        put_name(k);
+        put(',');
+        put_int(depth);
+        put(',');
+        put_int(val);
+        if (prune) {
+            put(',');
+            put_int(alpha);
+            put(',');
+            put_int(beta);
+        }
+        put('\n');
+    }
+    void node(const state &t, const int depth, const int val, const int alpha, const int beta) {
+        record(t.last_move, depth, val, alpha, beta);
+    }
+    void flush() {
+        out.write(buf, len);
+        len = 0;
+    }
+};
+
+/*
+ Binary traverse log back to the text one.
+ */
+bool decode_log(istream &in, ostream &out) {
+    unsigned char h[8], r[15];
+    if (!in.read((char *) h, 8) || memcmp(h, "MLOG", 4) || h[4] != LOG_VERSION) {
+        return false;
+    }
+    bool prune = h[6];
+    log_writer log(out, h[5], prune);
+    if (h[7]) {
+        log.header(prune? "Node,Depth,Value,Alpha,Beta": "Node,Depth,Value");
+    }
+    auto word = [&](const int i) {
+        return (int32_t) ((uint32_t) r[i] | (uint32_t) r[i + 1] << 8 | (uint32_t) r[i + 2] << 16 | (uint32_t) r[i + 3] << 24);
+    };
+    size_t size = prune? 15: 7;
+    while (in.read((char *) r, size)) {
+        log.record((int8_t) r[0], r[1] | r[2] << 8, word(3), prune? word(7): 0, prune? word(11): 0);
+    }
+    return in.gcount() == 0;
+}
+
+typedef chrono::steady_clock search_clock;
+
+/*
+ Search counters, collected with --stats only
+ */
+struct search_stats {
+    long long depth_nodes[MAX_DEPTH + 1];   //Nodes by depth
+    long long leaves;                       //Static evaluations
+    long long cutoffs;                      //Beta cutoffs
+    long long cutoff_at[MAX_PIT];           //Cutoffs by index of the cutoff move
+    long long extra_turns;                  //Moves played that gave an extra turn
+    long long captures;                     //Moves played that captured
+    int longest_chain;                      //Extra turns in a row
+    long long egdb_hits;                    //Nodes solved by the endgame database
+    long long researches;                   //Null-window scouts searched again
+    long long aspiration_fails;             //Root searches outside the window
+    long long qnodes;                       //Nodes past the horizon, in quiescence
+    long long reductions;                   //Late moves searched a turn shallower
+    long long reduction_fails;              //Reduced moves searched again in full
+    long long futile;                       //Leaves skipped by futility pruning
+    long long razored;                      //Nodes cut by razoring
+
+    search_stats() {
+        for (int d = 0; d <= MAX_DEPTH; ++d) {
+            depth_nodes[d] = 0;
+        }
+        for (int i = 0; i < MAX_PIT; ++i) {
+            cutoff_at[i] = 0;
+        }
+        leaves = cutoffs = extra_turns = captures = egdb_hits = 0;
+        researches = aspiration_fails = 0;
+        qnodes = 0;
+        reductions = reduction_fails = futile = razored = 0;
+        longest_chain = 0;
+    }
+    search_stats &operator+=(const search_stats &o) {
+        for (int d = 0; d <= MAX_DEPTH; ++d) {
+            depth_nodes[d] += o.depth_nodes[d];
+        }
+        for (int i = 0; i < MAX_PIT; ++i) {
+            cutoff_at[i] += o.cutoff_at[i];
+        }
+        leaves += o.leaves; cutoffs += o.cutoffs;
+        extra_turns += o.extra_turns; captures += o.captures;
+        egdb_hits += o.egdb_hits;
+        researches += o.researches; aspiration_fails += o.aspiration_fails;
+        qnodes += o.qnodes;
+        reductions += o.reductions; reduction_fails += o.reduction_fails;
+        futile += o.futile; razored += o.razored;
+        longest_chain = max(longest_chain, o.longest_chain);
+        return *this;
+    }
+    int max_depth() const {                 //Deepest depth with a node
+        int d = MAX_DEPTH;
+        while (d > 0 && depth_nodes[d] == 0) {
+            --d;
+        }
+        return d;
+    }
+};
+
+/*
+ Evaluation parameters, in 1/EVAL_SCALE of an evaluation unit, summed
+ over player 1's features minus player 2's. Read from a text file of
+ "name value..." lines, "#" starts a comment (the defaults shown):
+ mancala 280             per stone in the mancala
+ material 26             per stone in own pits
+ extra_turn 458          per move giving an extra turn
+ capture 135             per stone of the best capture on offer
+ pit 6 23 -26 -19 -19 69 192
+                         board size, then per stone by distance to the
+                         own mancala, nearest first
+ The defaults were tuned (see --tune in tournament.cpp) on depth-6
+ self-play, 300 openings of 4 stones for each board size.
+ */
+#define EVAL_SCALE 100
+
+struct eval_params {
+    int mancala;
+    int material;
+    int extra_turn;
+    int capture;
+    int pit[MAX_PIT + 1][MAX_PIT];      //By board size, distance to the own mancala
+
+    eval_params() {
+        static const int tuned[MAX_PIT + 1][MAX_PIT] = {
+            {}, {}, {},
+            {151, 149, -4},
+            {185, 66, 64, 76},
+            {106, 67, 26, 61, 56},
+            {23, -26, -19, -19, 69, 192},
+            {-43, -37, -46, -151, -33, 102, 286},
+            {-135, -127, -85, -113, -4, 72, 275, 236},
+            {-80, -94, -118, -107, -137, 108, 231, 211, 220},
+            {-131, -173, -136, -119, -5, 49, 121, 171, 182, 124},
+        };
+        mancala = 280;
+        material = 26;
+        extra_turn = 458;
+        capture = 135;
+        for (int n = 0; n <= MAX_PIT; ++n) {
+            for (int d = 0; d < MAX_PIT; ++d) {
+                pit[n][d] = tuned[n][d];
+            }
+        }
+    }
+    static const eval_params &defaults() {
+        static const eval_params p;
+        return p;
+    }
+    template <int N = 0>
+    int score(const state &s) const {               //Fixed point, from player 1's view
+        int n = s.pits<N>();
+        int v = mancala * (s.man1 - s.man2) + material * (s.side(1) - s.side(2));
+        const int *w = pit[n];
+        for (int i = 0; i < n; ++i) {                   //Pits i and i + n are as far from their mancalas
+            v += w[n - 1 - i] * (s.pit[i] - s.pit[i + n]);
+        }
+        return v + tactics<N>(s);
+    }
+    template <int N = 0>
+    int tactics(const state &s) const {             //The extra turn and capture terms of score
+        if (!extra_turn && !capture) {
+            return 0;
+        }
+        int n = s.pits<N>(), m = n << 1;
+        int turns = 0, best[3] = {0, 0, 0};
+        for (int k = 0; k < m; ++k) {
+            int p = (k < n)? 1: 2;
+            if (s.pit[k] == 0) {
+                continue;
+            }
+            turns += s.extra_turn<N>(k, p)? ((p == 1)? 1: -1): 0;
+            best[p] = max(best[p], s.capture<N>(k, p));
+        }
+        return extra_turn * turns + capture * (best[1] - best[2]);
+    }
+    static int units(const int v) {                 //Fixed point to evaluation units, rounded
+        return (v >= 0)? (v + EVAL_SCALE / 2) / EVAL_SCALE: -((-v + EVAL_SCALE / 2) / EVAL_SCALE);
+    }
+    template <int N = 0>
+    int value(const state &s) const {               //Rounded to evaluation units
+        return units(score<N>(s));
+    }
+    int count() const {                             //Parameters, as a flat list for the tuner
+        return 4 + (MAX_PIT + 1) * MAX_PIT;
+    }
+    bool used(const int i) const {                  //Not a pit weight past the board size
+        return i < 4 || ((i - 4) / MAX_PIT >= 3 && (i - 4) % MAX_PIT < (i - 4) / MAX_PIT);
+    }
+    int &operator[](const int i) {
+        int *head[4] = {&mancala, &material, &extra_turn, &capture};
+        return (i < 4)? *head[i]: pit[(i - 4) / MAX_PIT][(i - 4) % MAX_PIT];
+    }
+    bool load(istream &in) {
+        string line;
+        while (getline(in, line)) {
+            stringstream ss(line.substr(0, line.find('#')));
+            string key;
+            if (!(ss >> key)) {
+                continue;
+            }
+            if (key == "mancala") {
+                ss >> mancala;
+            } else if (key == "material") {
+                ss >> material;
+            } else if (key == "extra_turn") {
+                ss >> extra_turn;
+            } else if (key == "capture") {
+                ss >> capture;
+            } else if (key == "pit") {
+                int n = 0;
+                ss >> n;
+                if (n < 3 || n > MAX_PIT) {
+                    return false;
+                }
+                for (int d = 0; d < n; ++d) {
+                    ss >> pit[n][d];
+                }
+            } else {
+                return false;
+            }
+            if (ss.fail()) {
+                return false;
+            }
+        }
+        return true;
+    }
+    void save(ostream &out) const {
+        out << "mancala " << mancala << endl << "material " << material << endl
+            << "extra_turn " << extra_turn << endl << "capture " << capture << endl;
+        for (int n = 3; n <= MAX_PIT; ++n) {
+            out << "pit " << n;
+            for (int d = 0; d < n; ++d) {
+                out << " " << pit[n][d];
+            }
+            out << endl;
+        }
+    }
+};
+
+#define STATS_TEXT 1
+#define STATS_JSON 2
+
+/*
+ Search knobs from the command line, mostly task 4 only
+ */
+struct search_options {
+    int threads;                    //Lazy SMP search threads
+    int moves_to_go;                //Time slice is time_remain / moves_to_go
+    bool ordering;                  //Tactical, killer and history move ordering
+    bool pvs;                       //Principal variation search, aspiration windows
+    bool quiesce;                   //Captures and extra turns past the horizon
+    bool verbose;                   //Search diagnostics on stdout
+    int stats;                      //Search counters: 0 off, STATS_TEXT, STATS_JSON
+    const endgame_db *egdb;         //Exact endgame values, competition only
+    const opening_book *book;       //Whole turns played without a search, competition only
+    const eval_params *eval;        //Competition evaluation
+    atomic <bool> *stop_signal;     //Stop request from outside, e.g. the server's
+    bool uci;                       //"info" lines instead of "Depth" lines
+    bool specialize;                //Search code compiled for the board size
+    size_t mcts_mb;                 //MCTS tree arena, all threads
+    bool lmr;                       //Late move reductions
+    bool futility;                  //Leaves far below alpha are not searched
+    bool razor;                     //Nodes far below alpha two turns from the horizon drop into quiescence
+
+    search_options() {
+        threads = 1;
+        moves_to_go = 30;
+        ordering = true;
+        pvs = true;
+        quiesce = true;
+        verbose = true;
+        stats = 0;
+        egdb = nullptr;
+        book = nullptr;
+        eval = &eval_params::defaults();
+        stop_signal = nullptr;
+        uci = false;
+        specialize = true;
+        mcts_mb = 16;
+        lmr = false;
+        futility = false;
+        razor = false;
+    }
+};
+
+/*
+ History heuristic kept from one search to the next, e.g. across the
+ moves of a game in server mode.
+ */
+struct move_history {
+    int table[3][MAX_POS];          //By player, pit
+
+    move_history() {
+        clear();
+    }
+    void clear() {
+        for (int p = 0; p < 3; ++p) {
+            for (int k = 0; k < MAX_POS; ++k) {
+                table[p][k] = 0;
+            }
+        }
+    }
+};
+
+/*
+ Per-search stack buffers: the triangular PV table, indexed by ply,
+ plus the node counter and the deadline of a timed search.
+ Every search thread owns one.
+ */
+struct search_info {
+    int pv[MAX_PLY][MAX_PLY];
+    int pv_len[MAX_PLY];
+    trans_table *tt;                //nullptr: no transposition table
+    tt_stats stats;
+    long long nodes;
+    bool timed;                     //Abort at the deadline?
+    bool stop;                      //Aborted, every result is garbage
+    bool horizon;                   //Some leaf was cut by the depth limit
+    int root_shift;                 //Lazy SMP helpers rotate the root moves
+    bool ordering;                  //Move ordering below, kept across iterations
+    bool pvs;                       //Null-window scouts after the first move
+    bool quiesce;                   //Quiescence at the horizon
+    bool lmr, futility, razor;      //Selective search, competition only
+    int killer[MAX_PLY][3][2];       //By ply, player: extra turns mix both sides on a ply
+    int history[3][MAX_POS];        //By player, pit
+    int prev_pv[MAX_PLY];           //PV of the last completed iteration
+    int prev_pv_len;
+    bool pv_node[MAX_PLY];          //Still on prev_pv?
+    atomic <bool> *abort;           //Shared stop signal of a parallel search
+    bool collect;                   //Fill counters? See STAT
+    search_stats counters;
+    int chain[MAX_PLY];             //Extra turns in a row up to ply
+    search_clock::time_point deadline;
+
+    search_info() {
+        tt = nullptr;
+        nodes = 0;
+        timed = stop = horizon = false;
+        root_shift = 0;
+        abort = nullptr;
+        collect = false;
+        ordering = false;
+        pvs = false;
+        quiesce = false;
+        lmr = futility = razor = false;
+        prev_pv_len = 0;
+        for (int i = 0; i < MAX_PLY; ++i) {
+            killer[i][1][0] = killer[i][1][1] = killer[i][2][0] = killer[i][2][1] = -1;
+        }
+        for (int p = 0; p < 3; ++p) {
+            for (int k = 0; k < MAX_POS; ++k) {
+                history[p][k] = 0;
+            }
+        }
+    }
+    void next_iteration() {                     //Keep the PV, age the history
+        prev_pv_len = pv_len[0];
+        for (int i = 0; i < prev_pv_len; ++i) {
+            prev_pv[i] = pv[0][i];
+        }
+        pv_node[0] = true;
+        for (int p = 0; p < 3; ++p) {
+            for (int k = 0; k < MAX_POS; ++k) {
+                history[p][k] >>= 1;
+            }
+        }
+    }
+    bool check() {                              //Called once per node
+        if ((++nodes & 1023) == 0) {
+            if ((timed && search_clock::now() > deadline) || (abort && abort->load(memory_order_relaxed))) {
+                stop = true;
+            }
+        }
+        return stop;
+    }
+
+    void update_pv(const int ply, const int e) {
+        pv[ply][0] = e;
+        for (int i = 0; i < pv_len[ply + 1]; ++i) {
+            pv[ply][i + 1] = pv[ply + 1][i];
+        }
+        pv_len[ply] = pv_len[ply + 1] + 1;
+    }
+};
+
+/*
+ Outcome of an iterative deepening run
+ */
+struct search_report {
+    int depth;                      //Last completed iteration
+    int val;
+    vector <int> pv;
+    long long nodes;                //All threads
+    double elapsed;
+    vector <double> depth_time;     //Seconds until each depth completed
+    tt_stats stats;
+    search_stats counters;
+
+    search_report() {
+        depth = val = 0;
+        nodes = 0;
+        elapsed = 0;
+    }
+};
+
+inline void print_stats(ostream &out, const search_report &r, const bool json) {
+    const search_stats &c = r.counters;
+    int dmax = c.max_depth();
+    double nps = r.nodes / max(r.elapsed, 1e-9);
+    double first = c.cutoffs? 100.0 * c.cutoff_at[0] / c.cutoffs: 0;
+    out << fixed << setprecision(1);
+    if (json) {
+        out << "{\"nodes\":" << r.nodes << ",\"seconds\":" << setprecision(6) << r.elapsed
+            << setprecision(0) << ",\"nps\":" << nps << ",\"depth\":" << r.depth << ",\"depth_nodes\":[";
+        for (int d = 0; d <= dmax; ++d) {
+            out << (d? ",": "") << c.depth_nodes[d];
+        }
+        out << "],\"leaves\":" << c.leaves << ",\"cutoffs\":" << c.cutoffs << ",\"cutoff_at\":[";
+        for (int i = 0; i < MAX_PIT; ++i) {
+            out << (i? ",": "") << c.cutoff_at[i];
+        }
+        out << "],\"extra_turns\":" << c.extra_turns << ",\"longest_chain\":" << c.longest_chain
+            << ",\"captures\":" << c.captures << ",\"tt_probes\":" << r.stats.probes
+            << ",\"tt_hits\":" << r.stats.hits << ",\"tt_cutoffs\":" << r.stats.cutoffs << ",\"egdb_hits\":" << c.egdb_hits
+            << ",\"researches\":" << c.researches << ",\"aspiration_fails\":" << c.aspiration_fails
+            << ",\"qnodes\":" << c.qnodes << ",\"reductions\":" << c.reductions << ",\"reduction_fails\":" << c.reduction_fails
+            << ",\"futile\":" << c.futile << ",\"razored\":" << c.razored << "}";
+    } else {
+        out << "Stats: nodes " << r.nodes << " in " << setprecision(3) << r.elapsed << "s (" << setprecision(0) << nps << " nps)"
+            << ", leaves " << c.leaves << ", cutoffs " << c.cutoffs << " (" << setprecision(1) << first << "% on the first move)"
+            << ", extra turns " << c.extra_turns << " (longest chain " << c.longest_chain << ")"
+            << ", captures " << c.captures << ", TT hits " << r.stats.hits << ", endgame hits " << c.egdb_hits
+            << ", re-searches " << c.researches << ", aspiration fails " << c.aspiration_fails
+            << ", quiescence nodes " << c.qnodes << " (" << setprecision(1) << 100.0 * c.qnodes / max(r.nodes, 1LL) << "%)" << endl;
+        if (c.reductions || c.futile || c.razored) {
+            out << "Selectivity: reductions " << c.reductions << " (" << 100.0 * c.reduction_fails / max(c.reductions, 1LL)
+                << "% searched again), futile leaves " << c.futile << ", razored nodes " << c.razored << endl;
+        }
+        out << "Nodes by depth: [";
+        for (int d = 0; d <= dmax; ++d) {
+            out << (d? " ": "") << c.depth_nodes[d];
+        }
+        out << "]" << endl << "Cutoffs by move index: [";
+        for (int i = 0; i < MAX_PIT; ++i) {
+            out << (i? " ": "") << c.cutoff_at[i];
+        }
+        out << "]";
+    }
+    out.unsetf(ios::fixed);
+}
+
+/*
+ Monte Carlo tree search, task 5: UCT over single sowings. Each thread
+ grows its own tree (root parallel) in an arena sized once up front;
+ when it is full the leaves stop expanding. A playout makes random moves
+ from the leaf, mostly extra turns and captures when there are some, for
+ at most MCTS_PLAYOUT_PLY plies and is scored through the evaluation if
+ the game is not over by then.
+ */
+#define TASK_MCTS 5
+#define MCTS_PLAYOUT_PLY 32
+#define MCTS_PLAYOUTS 20000         //Per move, without a clock
+#define MCTS_EXPLORE 1.4
+#define MCTS_TACTICAL 75            //Percent of playout moves that take an extra turn or a capture if any
+#define MCTS_SCALE 0.02             //Evaluation to result: logistic in units of this many pits' worth of stones
+
+struct mcts_node {
+    int32_t child;                  //First child in the arena, -1 if not expanded
+    int8_t nchild;
+    int8_t move;                    //Pit played into this node
+    int8_t who;                     //By whom
+    uint32_t visits;
+    float wins;                     //Of who's, a draw is half
+};
+
+inline uint64_t next_random(uint64_t &x) {      //xorshift64*
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+/*
+ This is a immutable class!
+ */
+class board {
+#define TASK_GREEDY       1
+#define TASK_MINIMAX      2
+#define TASK_ALPHA_BETA   3
+#define TASK_COMPETITION  4
+
+#define OUTPUT_WIDTH 5
+
+private:
+    enum player{player1 = 1, player2 = 2};
+    int n;                  //Board size
+    int m;                  //Total size (n * 2)
+    int task;               //The task to make the move
+    int cutoff;             //Search cutoff depth
+    state pos;              //Position
+    trans_table *tt;        //Shared by all copies, competition only
+    move_history *hist;     //Warm history between searches, or nullptr
+    double time_remain;     //Seconds on our clock, <= 0 means fixed depth
+    search_options opt;
+public:
+    board() {
+    }
+    board(const int task1, const int cutoff1, const int who1, const vector <int> &p2, const vector <int> &p1, const int m2, const int m1) {
+
+        assert(!p1.empty() && !p2.empty() && p1.size() == p1.size());
+        assert(p1.size() <= MAX_PIT);
+
+        task = task1;
+        cutoff = cutoff1;
+        tt = nullptr;
+        hist = nullptr;
+        time_remain = 0;
+        n = (int) p1.size();
+        m = n << 1;
+
+        pos.n = n;
+        pos.last_move = -1;
+        if (who1 == 1) {
+            pos.who = player1;
+            pos.whom = player2;
+        } else {
+            pos.who = player2;
+            pos.whom = player1;
+        }
+
+        pos.man1 = m1; pos.man2 = m2;
+
+        //Initializing the board
+        for (int i = 0; i < n; ++i) {           //Player 1
+            pos.pit[i] = p1[i];
+        }
+        for (int i = n - 1; i >= 0; --i) {
+            pos.pit[m - 1 - i] = p2[i];
+        }
+        pos.compute_hash();
+        pos.count_sides();
+
+
+        if (task == TASK_GREEDY) {
+            cutoff = 1;
+        } else if (task == TASK_COMPETITION) {
+            cutoff = compute_cutoff(n, pos.side(player1) + pos.side(player2));
+        }
+
+        assert(!game_over());
+    }
+
+    int compute_cutoff(const int n, const int tot) const {      //size, total on board
+        /*
+            n: 3 ~ 10
+            tot: 1 ~ 10000
+        */
+
+        return (int) round(12 - sqrt(n) - log(tot) / log(15));
+    }
+
+
+    friend inline ostream &operator<<(ostream &out, const board &my_board) {
+        //print the position
+        //return out << my_board.position;
+        int n = my_board.n;
+        int m = my_board.m;
+        const state &pos = my_board.pos;
+        out << pos.man2 << endl;
+        for (int i = m - 1; i >= n + 1; --i) {
+            out << setw(OUTPUT_WIDTH) << pos.pit[i];
+        }
+        out << setw(OUTPUT_WIDTH) << pos.pit[n] << endl;
+        for (int i = 0; i < n - 1; ++i) {
+            out << setw(OUTPUT_WIDTH) << pos.pit[i];
+        }
+        out << setw(OUTPUT_WIDTH) << pos.pit[n-1];
+        out << endl << setw(OUTPUT_WIDTH * (n + 1)) << pos.man1;
+
+
+        out << endl << "Player " << pos.who << " to move";
+        out << endl << "Cutoff depth: " << my_board.cutoff;
+        int current_eval = my_board.eval();
+        out << endl << "Position analysis: " << ((current_eval >= 0)? "+": "") << current_eval;
+        vector <int> candidate = my_board.get_candidate();
+        out << endl << "Candidate move: " << candidate << "; " << my_board.get_pit_name(candidate);
+        out << endl << "----------------";
+        return out;
+    }
+    inline string to_str() const {                //The output
+        string ret = "";
+        for (int i = m - 1; i >= n + 1; --i) {
+            ret += to_string(pos.pit[i]) + " ";
+        }
+        ret += to_string(pos.pit[n]) + "\n";
+        for (int i = 0; i < n - 1; ++i) {
+            ret += to_string(pos.pit[i]) + " ";
+        }
+        ret += to_string(pos.pit[n-1]) + "\n" + to_string(pos.man2) + "\n" + to_string(pos.man1);
+        return ret;
+    }
+
+    int size() const {
+        return n;
+    }
+    void use_table(trans_table *t) {
+        tt = t;
+    }
+    void use_history(move_history *h) {
+        hist = h;
+    }
+    void set_task(const int task1) {                        //TASK_COMPETITION or TASK_MCTS for the same position
+        task = task1;
+    }
+    void set_clock(const double time_remain1) {
+        time_remain = time_remain1;
+    }
+    void set_options(const search_options &opt1) {
+        opt = opt1;
+        opt.threads = max(opt.threads, 1);
+        opt.moves_to_go = max(opt.moves_to_go, 1);
+    }
+    int depth() const {
+        return cutoff;
+    }
+    void set_depth(const int cutoff1) {
+        cutoff = cutoff1;
+    }
+    search_report analyse(const int max_depth) const {      //Untimed iterative deepening, for benchmarks
+        return iterate(0, 0, max_depth, false);
+    }
+    search_report think(const double slice, const double hard, const int max_depth) const {    //slice <= 0: no clock
+        return iterate(slice, hard, max_depth, opt.verbose);
+    }
+    board play(const search_report &r, vector <string> &the_move) const {  //Play the PV's first turn
+        board b = *this;
+        b.cutoff = r.depth;
+        return b.play_pv(the_move, r.pv, r.val);
+    }
+    bool book_turn(search_report &r) const {               //The whole turn, if the book has every step
+        if (!opt.book || task != TASK_COMPETITION) {
+            return false;
+        }
+        r = search_report();
+        board b = *this;
+        book_entry e;
+        while (!b.game_over() && b.turn() == turn()) {
+            if (!opt.book->probe(b.pos, e) || !b.pos.is_own_pit(e.pit) || b.pos.pit[e.pit] == 0) {
+                return false;
+            }
+            if (r.pv.empty()) {
+                r.val = e.value;
+                r.depth = e.depth;
+            }
+            r.pv.push_back(e.pit);
+            b = b.move(e.pit);
+        }
+        return true;
+    }
+    board as_root() const {                                 //Searchable from here, whoever moved last
+        board b = *this;
+        b.reset();
+        return b;
+    }
+    int parse_pit(const string &name) const {              //"B3" -> 1, -1 if no such pit
+        int k = (name.size() > 1 && isdigit(name[1]))? atoi(name.c_str() + 1): 0;
+        if (name[0] == 'B' && k >= 2 && k <= n + 1) {
+            return k - 2;
+        }
+        if (name[0] == 'A' && k >= 2 && k <= n + 1) {
+            return m - k + 1;
+        }
+        return -1;
+    }
+    int turn() const {
+        return pos.who;
+    }
+    vector<int> get_candidate() const {
+        int cand[MAX_PIT];
+        int nc = pos.candidates(cand);
+        return vector<int>(cand, cand + nc);
+    }
+    vector<int> get_position() const {
+        return vector<int>(pos.pit, pos.pit + m);
+    }
+    const state &get_state() const {
+        return pos;
+    }
+    int mancala(const int p) const {
+        return (p == player1)? pos.man1: pos.man2;
+    }
+
+    board move(vector <string> &history_moves, log_writer *log = nullptr, search_report *report = nullptr) const { //NOT a mutator!
+        //assert(has_legal_move());
+        assert(!game_over());
+
+        vector<string> the_move;
+        board next;
+        search_report r;
+        switch (task) {
+            case TASK_GREEDY:
+                next = move_minimax(history_moves, log, false, report);
+                return next;
+            case TASK_MINIMAX:
+                next = move_minimax(history_moves, log, false, report);
+                return next;
+            case TASK_ALPHA_BETA:
+                next = move_minimax(history_moves, log, true, report);
+                return next;
+            case TASK_COMPETITION:
+                if (book_turn(r)) {
+                    if (opt.verbose && !opt.uci) {
+                        cout << "Book: depth " << r.depth << endl;
+                    }
+                    if (report) {
+                        *report = r;
+                    }
+                    next = play_pv(history_moves, r.pv, r.val);
+                } else if (time_remain > 0) {
+                    next = move_iterative(history_moves, report);
+                } else {
+                    next = move_minimax(history_moves, log, true, report);
+                }
+                return next;
+            case TASK_MCTS:
+                return move_mcts(history_moves, report);
+            default:
+                return *this;
+        }
+
+    }
+
+    board move(const int k) const {                    //Choose the k th pit
+        board t = *this;
+        t.pos.play(k);
+        return t;                               //Change turn;
+    }
+
+    bool game_over() const {                                //Game over
+        return pos.game_over();
+    }
+
+private:                        //Private methods
+
+    template <int N = 0>
+    int eval(const state &s, const int p) const {       //Evaluation from p's perspective
+        if (p == player1) {
+            return eval<N>(s);
+        } else {
+            return -eval<N>(s);
+        }
+    }
+    template <int N = 0>
+    int eval(const state &s) const {                    //Who stands better?
+        if (task != TASK_COMPETITION) {
+            return s.man1 - s.man2;
+        } else {
+            return eval_comp<N>(s);
+        }
+    }
+    int eval() const {
+        return eval(pos);
+    }
+    template <int N = 0>
+    int eval_comp(const state &s) const {                //From Player1's perspective
+        int t = s.side(player1) + s.side(player2);
+        if (s.man1 - s.man2 > t) {                   //Winning position for 1
+            return WINNING;
+        }
+        if (s.man2 - s.man1 > t) {                   //Winning position for 2
+            return LOSING;
+        }
+        return opt.eval->value<N>(s);
+    }
+
+    board move_minimax(vector<string>& the_move, log_writer *log, const bool prune, search_report *report) const {              //prune==false -> no alpha beta
+        search_clock::time_point start = search_clock::now();
+        search_info info;
+        info.tt = (task == TASK_COMPETITION && tt && tt->enabled())? tt: nullptr;
+        info.ordering = task == TASK_COMPETITION && opt.ordering;
+        info.collect = opt.stats != 0;
+        info.pv_node[0] = false;
+        info.pvs = task == TASK_COMPETITION && opt.pvs;
+        info.quiesce = task == TASK_COMPETITION && opt.quiesce;
+        info.lmr = task == TASK_COMPETITION && opt.lmr && opt.ordering;
+        info.futility = task == TASK_COMPETITION && opt.futility;
+        info.razor = task == TASK_COMPETITION && opt.razor;
+        if (info.tt) {
+            tt->new_search();
+        }
+        int val = search_root(log, info, -MAX_INT, MAX_INT, prune);//Find optimal
+        vector <int> pv(info.pv[0], info.pv[0] + info.pv_len[0]);
+        search_report r;
+        r.depth = cutoff;
+        r.val = val;
+        r.pv = pv;
+        r.nodes = info.nodes;
+        r.elapsed = chrono::duration<double>(search_clock::now() - start).count();
+        r.stats = info.stats;
+        r.counters = info.counters;
+        if (info.tt && opt.verbose) {
+            cout << info.stats << endl;
+        }
+        if (opt.stats && opt.verbose) {
+            print_stats(cout, r, opt.stats == STATS_JSON);
+            cout << endl;
+        }
+        if (report) {
+            *report = r;
+        }
+        return play_pv(the_move, pv, val);
+    }
+    /*
+     MCTS: playouts until the clock's slice is spent (MCTS_PLAYOUTS without
+     a clock), then the turn follows the most visited moves of all trees.
+     Past the trees' reach the rest of the turn goes to the best-evaluated
+     move. The reported value is the first move's win rate, -100 ~ +100, or
+     its evaluation on the same scale if no tree expanded the root.
+     */
+    board move_mcts(vector<string>& the_move, search_report *report) const {
+        search_clock::time_point start = search_clock::now();
+        bool timed = time_remain > 0;
+        search_clock::time_point deadline = start + chrono::duration_cast<search_clock::duration>(chrono::duration<double>(time_remain / opt.moves_to_go));
+        int nthreads = opt.threads;
+        size_t cap = max(((size_t) opt.mcts_mb << 20) / sizeof(mcts_node) / nthreads, (size_t) MAX_PIT + 1);
+        vector <unique_ptr <mcts_node[]> > trees;
+        for (int i = 0; i < nthreads; ++i) {
+            trees.push_back(unique_ptr <mcts_node[]> (new mcts_node[cap]));     //Pages are touched only as the tree grows
+        }
+        vector <long long> done(nthreads, 0);
+        vector <int> depth(nthreads, 0);
+        vector <thread> helpers;
+        for (int i = 1; i < nthreads; ++i) {
+            helpers.push_back(thread(&board::mcts_thread, this, trees[i].get(), cap, MCTS_PLAYOUTS / nthreads, timed, deadline, i, ref(done[i]), ref(depth[i])));
+        }
+        mcts_thread(trees[0].get(), cap, MCTS_PLAYOUTS - MCTS_PLAYOUTS / nthreads * (nthreads - 1), timed, deadline, 0, done[0], depth[0]);
+        for (auto &t: helpers) {
+            t.join();
+        }
+
+        search_report r;
+        vector <int> at(nthreads, 0);               //Each tree's node for the turn so far
+        board b = *this;
+        while (!b.game_over() && b.turn() == turn()) {
+            long long visits[MAX_POS] = {0};
+            double wins[MAX_POS] = {0};
+            for (int t = 0; t < nthreads; ++t) {
+                const mcts_node &p = trees[t][max(at[t], 0)];
+                for (int c = p.child; at[t] >= 0 && c >= 0 && c < p.child + p.nchild; ++c) {
+                    visits[trees[t][c].move] += trees[t][c].visits;
+                    wins[trees[t][c].move] += trees[t][c].wins;
+                }
+            }
+            int best = -1;
+            for (int k = 0; k < b.size() * 2; ++k) {
+                if (visits[k] > 0 && (best < 0 || visits[k] > visits[best])) {
+                    best = k;
+                }
+            }
+            if (best < 0) {
+                best = b.greedy_move();
+                if (r.pv.empty()) {                 //No tree got past the root: the greedy move's evaluation
+                    state t = b.pos;
+                    t.play(best);
+                    double p1 = outcome(t);
+                    r.val = (int) lround(200 * ((b.pos.who == player1)? p1: 1 - p1) - 100);
+                }
+            } else if (r.pv.empty()) {
+                r.val = (int) lround(200 * wins[best] / visits[best] - 100);
+            }
+            for (int t = 0; t < nthreads; ++t) {
+                const mcts_node &p = trees[t][max(at[t], 0)];
+                int next = -1;
+                for (int c = p.child; at[t] >= 0 && c >= 0 && c < p.child + p.nchild; ++c) {
+                    next = (trees[t][c].move == best)? c: next;
+                }
+                at[t] = next;
+            }
+            r.pv.push_back(best);
+            b = b.move(best);
+        }
+        r.elapsed = chrono::duration<double>(search_clock::now() - start).count();
+        for (int t = 0; t < nthreads; ++t) {
+            r.nodes += done[t];
+            r.depth = max(r.depth, depth[t]);
+        }
+        if (opt.verbose && !opt.uci) {
+            cout << fixed << setprecision(3) << "MCTS: " << r.nodes << " playouts, " << nthreads << " threads, tree depth " << r.depth
+                 << ", " << r.elapsed << "s" << endl;
+            cout.unsetf(ios::fixed);
+        }
+        if (report) {
+            *report = r;
+        }
+        return play_pv(the_move, r.pv, r.val);
+    }
+    void mcts_thread(mcts_node *tree, const size_t cap, const long long playouts, const bool timed, const search_clock::time_point deadline,
+                     const int id, long long &done, int &max_len) const {
+        uint64_t rng = 0x9E3779B97F4A7C15ULL * (id + 1);
+        size_t used = 1;
+        tree[0] = mcts_node{-1, 0, -1, (int8_t) pos.whom, 0, 0};
+        vector <int> path;
+        for (done = 0; timed || done < playouts; ++done) {
+            if (timed && (done & 63) == 0 && search_clock::now() >= deadline) {
+                break;
+            }
+            state s = pos;
+            int cur = 0;
+            path.assign(1, 0);
+            while (tree[cur].child >= 0 && !s.game_over()) {
+                cur = mcts_select(tree, cur);
+                s.play(tree[cur].move);
+                path.push_back(cur);
+            }
+            if (!s.game_over() && (cur == 0 || tree[cur].visits > 0)) {     //Expand on the second visit
+                int cand[MAX_PIT];
+                int nc = s.candidates(cand);
+                if (used + nc <= cap) {
+                    tree[cur].child = used;
+                    tree[cur].nchild = nc;
+                    for (int i = 0; i < nc; ++i) {
+                        tree[used + i] = mcts_node{-1, 0, (int8_t) cand[i], (int8_t) s.who, 0, 0};
+                    }
+                    used += nc;
+                    cur = tree[cur].child;
+                    s.play(tree[cur].move);
+                    path.push_back(cur);
+                }
+            }
+            double r1 = playout(s, rng);
+            for (auto i: path) {
+                ++tree[i].visits;
+                tree[i].wins += (tree[i].who == player1)? r1: 1 - r1;
+            }
+            max_len = max(max_len, (int) path.size() - 1);
+        }
+    }
+    int mcts_select(const mcts_node *tree, const int cur) const {     //UCT
+        const mcts_node &p = tree[cur];
+        double logn = log((double) p.visits);
+        int best = p.child;
+        double best_v = -1;
+        for (int c = p.child; c < p.child + p.nchild; ++c) {
+            const mcts_node &e = tree[c];
+            if (e.visits == 0) {
+                return c;
+            }
+            double v = e.wins / e.visits + MCTS_EXPLORE * sqrt(logn / e.visits);
+            if (v > best_v) {
+                best_v = v;
+                best = c;
+            }
+        }
+        return best;
+    }
+    double playout(state s, uint64_t &rng) const {      //Player 1's share of the result
+        for (int ply = 0; ply < MCTS_PLAYOUT_PLY && !s.game_over(); ++ply) {
+            int cand[MAX_PIT] = {0};
+            int nc = s.candidates(cand);
+            uint64_t x = next_random(rng);
+            int k = cand[x % nc];
+            if ((x >> 32) % 100 < MCTS_TACTICAL) {
+                for (int i = 0; i < nc; ++i) {
+                    if (s.extra_turn(cand[i]) || s.capture(cand[i]) > 0) {
+                        k = cand[i];
+                        break;
+                    }
+                }
+            }
+            s.play(k);
+        }
+        return outcome(s);
+    }
+    double outcome(const state &s) const {              //Player 1's share, from the evaluation short of the end
+        if (s.game_over()) {
+            return (s.man1 > s.man2)? 1: (s.man1 < s.man2)? 0: 0.5;
+        }
+        int v = eval_comp(s);
+        if (abs(v) == WINNING) {
+            return (v > 0)? 1: 0;
+        }
+        double scale = MCTS_SCALE * max((s.side(1) + s.side(2) + s.man1 + s.man2) / (2 * s.n), 1);     //A pit's worth of stones
+        return 1 / (1 + exp(-v / scale));
+    }
+    int greedy_move() const {                           //Best evaluation one sowing ahead
+        int cand[MAX_PIT];
+        int nc = pos.candidates(cand);
+        int best = -1, best_v = -MAX_INT;
+        for (int i = 0; i < nc; ++i) {
+            state t = pos;
+            t.play(cand[i]);
+            int v = eval_comp(t);
+            v = (pos.who == player1)? v: -v;
+            if (best < 0 || v > best_v) {
+                best_v = v;
+                best = cand[i];
+            }
+        }
+        return best;
+    }
+    /*
+     Iterative deepening under a time slice of the remaining clock.
+     A new iteration is not started past half the slice, a running one is
+     aborted at the hard limit and the last completed iteration is played.
+     */
+    board move_iterative(vector<string>& the_move, search_report *report) const {
+        double slice = time_remain / opt.moves_to_go;
+        double hard = min(slice * 3, time_remain / 4);
+        search_report r = iterate(slice, hard, MAX_DEPTH, opt.verbose);
+        if (tt && tt->enabled() && opt.verbose) {
+            cout << r.stats << endl;
+        }
+        if (opt.stats && opt.verbose) {
+            print_stats(cout, r, opt.stats == STATS_JSON);
+            cout << endl;
+        }
+        if (report) {
+            *report = r;
+        }
+        board b = *this;
+        b.cutoff = r.depth;
+        return b.play_pv(the_move, r.pv, r.val);
+    }
+    /*
+     Lazy SMP: thread 0 runs the iterative deepening below, helpers search
+     the same root with rotated root moves and staggered depths and only
+     share the transposition table. With one thread nothing else runs, so
+     the search is deterministic. slice <= 0 means no clock.
+     */
+    search_report iterate(const double slice, const double hard, const int max_depth, const bool verbose) const {
+        search_clock::time_point start = search_clock::now();
+        int nthreads = opt.threads;
+        atomic <bool> abort(false);
+        vector <unique_ptr <search_info> > infos;
+        for (int i = 0; i < nthreads; ++i) {
+            infos.push_back(unique_ptr <search_info> (new search_info()));
+            infos[i]->tt = (tt && tt->enabled())? tt: nullptr;
+            infos[i]->root_shift = i;
+            infos[i]->ordering = opt.ordering;
+            infos[i]->pvs = opt.pvs;
+            infos[i]->quiesce = opt.quiesce;
+            infos[i]->lmr = opt.lmr && opt.ordering;
+            infos[i]->futility = opt.futility;
+            infos[i]->razor = opt.razor;
+            infos[i]->collect = opt.stats != 0;
+            infos[i]->pv_node[0] = false;
+            infos[i]->abort = (i > 0)? &abort: nullptr;
+            infos[i]->deadline = start + chrono::duration_cast<search_clock::duration>(chrono::duration<double>(hard));
+            if (hist) {
+                memcpy(infos[i]->history, hist->table, sizeof(hist->table));
+            }
+        }
+        if (infos[0]->tt) {
+            tt->new_search();
+        }
+        vector <thread> helpers;
+        for (int i = 1; i < nthreads; ++i) {
+            helpers.push_back(thread(&board::helper_search, this, ref(*infos[i]), max_depth, i));
+        }
+
+        search_info &info = *infos[0];
+        search_report r;
+        board b = *this;
+        for (int d = 1; d <= max_depth; ++d) {
+            b.cutoff = d;
+            info.timed = slice > 0 && d > 1;    //Always finish depth 1
+            info.abort = (d > 1)? opt.stop_signal: nullptr;
+            info.horizon = false;
+            long long nodes0 = info.nodes;
+            long long delta = ASPIRATION_WINDOW;
+            int alpha = -MAX_INT, beta = MAX_INT;
+            if (opt.pvs && d > 1 && abs(r.val) < WINNING) {
+                alpha = (int) max(-(long long) MAX_INT, r.val - delta);
+                beta = (int) min((long long) MAX_INT, r.val + delta);
+            }
+            int v = b.search_root(nullptr, info, alpha, beta, true);
+            while (!info.stop && ((v <= alpha && alpha > -MAX_INT) || (v >= beta && beta < MAX_INT))) {
+                STAT(++info.counters.aspiration_fails);
+                delta *= 4;
+                if (v <= alpha) {
+                    alpha = (int) max(-(long long) MAX_INT, v - delta);
+                } else {
+                    beta = (int) min((long long) MAX_INT, v + delta);
+                }
+                v = b.search_root(nullptr, info, alpha, beta, true);
+            }
+            double elapsed = chrono::duration<double>(search_clock::now() - start).count();
+            if (info.stop) {
+                if (verbose && !opt.uci) {
+                    cout << fixed << setprecision(3) << "Depth " << d << ": aborted after " << info.nodes - nodes0 << " nodes, " << elapsed << "s" << endl;
+                    cout.unsetf(ios::fixed);
+                }
+                break;
+            }
+            r.depth = d;
+            r.val = v;
+            r.pv.assign(info.pv[0], info.pv[0] + info.pv_len[0]);
+            r.depth_time.push_back(elapsed);
+            info.next_iteration();
+            if (verbose && opt.uci) {
+                ostringstream line;
+                line << "info depth " << d << " score " << v << " nodes " << info.nodes << " time " << (long long) (elapsed * 1000) << " pv";
+                for (auto e: r.pv) {
+                    line << " " << get_pit_name(e);
+                }
+                cout << line.str() + "\n" << flush;
+            } else if (verbose) {
+                cout << fixed << setprecision(3) << "Depth " << d << ": " << ((v >= 0)? "+": "") << v << ", nodes " << info.nodes - nodes0 << ", " << elapsed << "s, PV " << get_pit_name(r.pv) << endl;
+                cout.unsetf(ios::fixed);
+            }
+            if (!info.horizon || (slice > 0 && elapsed > slice / 2)) {     //Solved, or no time for one more
+                break;
+            }
+        }
+
+        abort = true;
+        for (auto &t: helpers) {
+            t.join();
+        }
+        if (hist) {
+            memcpy(hist->table, info.history, sizeof(hist->table));
+        }
+        r.elapsed = chrono::duration<double>(search_clock::now() - start).count();
+        for (auto &e: infos) {
+            r.nodes += e->nodes;
+            r.stats += e->stats;
+            r.counters += e->counters;
+        }
+        return r;
+    }
+    void helper_search(search_info &info, const int max_depth, const int id) const {
+        board b = *this;
+        for (int d = 1 + (id & 1); d <= max_depth && !info.stop; ++d) {
+            b.cutoff = d;
+            info.horizon = false;
+            b.search_root(nullptr, info, -MAX_INT, MAX_INT, true);
+            if (!info.horizon) {
+                break;
+            }
+            info.next_iteration();
+        }
+    }
+    board play_pv(vector<string>& the_move, const vector <int> &pv, const int val) const {
+        int expected = (pos.who == player1)? val: -val;     //The PV may be cut short by the table
+        if (opt.verbose && !opt.uci) {
+            cout << "After move: " << get_pit_name(pv) << ", expected analysis: " << ((expected >= 0)? "+": "") << expected << endl;
+        }
+
+
+        board next = *this;    //Make the decision
+        for (auto e: pv) {
+            next = next.move(e);
+            the_move.push_back(get_pit_name(e));
+            if (pos.who != next.turn()) {
+                break;
+            }
+        }
+
+        next.reset();                                   //Reset the new node as a root
+        return next;
+    }
+    /*
+     Transposition table glue. Values are from the side to move's view, as
+     in the search. Nodes still in the root player's first turn never take
+     a cutoff: move_minimax needs their full PV to play the move.
+     */
+    int tt_draft(const state &s, const int depth) const {
+        return cutoff - depth + (s.who == s.whom);
+    }
+    bool tt_probe(search_info &info, const state &s, const int depth, const int alpha, const int beta, int &v, int &tt_move) const {
+        tt_entry e;
+        if (!info.tt->probe(s.hash, e, info.stats)) {
+            return false;
+        }
+        tt_move = e.move;
+        if (e.draft < tt_draft(s, depth) || (depth <= 1 && s.who == pos.who)) {
+            return false;
+        }
+        int tv = e.value;
+        if (e.bound == BOUND_EXACT || (e.bound == BOUND_LOWER && tv >= beta) || (e.bound == BOUND_UPPER && tv <= alpha)) {
+            ++info.stats.cutoffs;
+            info.horizon = true;                //Unknown, assume the entry saw one
+            v = tv;
+            return true;
+        }
+        return false;
+    }
+    void tt_store(search_info &info, const state &s, const int depth, const int v, const int alpha0, const int beta0, const int best_move) const {
+        int bound = (v >= beta0)? BOUND_LOWER: (v <= alpha0)? BOUND_UPPER: BOUND_EXACT;
+        info.tt->store(s.hash, tt_draft(s, depth), v, bound, best_move, info.stats);
+    }
+    /*
+     Move ordering: last iteration's PV move, table move, extra turns,
+     captures (bigger first), the two killers of the ply, then history.
+     Ties keep the highest-pit-first order of candidates().
+     */
+    template <int N>
+    void order_moves(search_info &info, const state &s, const int ply, int *cand, const int nc, const int tt_move) const {
+        int pv_move = (info.pv_node[ply] && ply < info.prev_pv_len)? info.prev_pv[ply]: -1;
+        int score[MAX_PIT];
+        for (int i = 0; i < nc; ++i) {
+            int e = cand[i];
+            int c;
+            if (e == pv_move) {
+                score[i] = 1 << 30;
+            } else if (e == tt_move) {
+                score[i] = 1 << 29;
+            } else if (s.extra_turn<N>(e)) {
+                score[i] = (1 << 28) + e;           //Nearest the mancala first, it leaves the others intact
+            } else if ((c = s.capture<N>(e)) > 0) {
+                score[i] = (1 << 27) + min(c, 1 << 20);
+            } else if (e == info.killer[ply][s.who][0]) {
+                score[i] = 1 << 26;
+            } else if (e == info.killer[ply][s.who][1]) {
+                score[i] = 1 << 25;
+            } else {
+                score[i] = min(info.history[s.who][e], (1 << 25) - 1);
+            }
+        }
+        for (int i = 1; i < nc; ++i) {          //Stable insertion sort, nc <= 10
+            int e = cand[i], sc = score[i], j = i;
+            for (; j > 0 && score[j - 1] < sc; --j) {
+                cand[j] = cand[j - 1];
+                score[j] = score[j - 1];
+            }
+            cand[j] = e;
+            score[j] = sc;
+        }
+    }
+    template <int N>
+    void record_cutoff(search_info &info, const state &s, const int ply, const int e, const int depth) const {
+        if (s.extra_turn<N>(e) || s.capture<N>(e) > 0) {
+            return;
+        }
+        int *k = info.killer[ply][s.who];
+        if (k[0] != e) {
+            k[1] = k[0];
+            k[0] = e;
+        }
+        int d = tt_draft(s, depth);
+        info.history[s.who][e] += d * d;
+    }
+    void order_first(int *cand, const int nc, const int e) const {      //Move e to the front, keep the rest
+        for (int i = 0; i < nc; ++i) {
+            if (cand[i] == e) {
+                for (; i > 0; --i) {
+                    cand[i] = cand[i - 1];
+                }
+                cand[0] = e;
+                return;
+            }
+        }
+    }
+    /*
+     Endgame database glue: a won, lost or drawn position is a leaf. Not in
+     the root player's first turn, which move_minimax must play out in full.
+     */
+    bool egdb_probe(const state &s, const int depth, const int ply, int &v) const {
+        int margin = 0;
+        v = 0;                              //Defined even on a miss
+        if (!opt.egdb || task != TASK_COMPETITION || ply == 0 || (depth <= 1 && s.who == pos.who) || !opt.egdb->probe(s, margin)) {
+            return false;
+        }
+        v = (margin > 0)? WINNING: (margin < 0)? LOSING: 0;
+        v = (s.who == player1)? v: -v;
+        return true;
+    }
+    int search_root(log_writer *log, search_info &info, const int alpha, const int beta, const bool prune) const {
+        switch (opt.specialize? n: 0) {             //Board sizes 3 ~ MAX_PIT
+        case 3: return negamax<3>(pos, log, info, 0, 0, alpha, beta, prune);
+        case 4: return negamax<4>(pos, log, info, 0, 0, alpha, beta, prune);
+        case 5: return negamax<5>(pos, log, info, 0, 0, alpha, beta, prune);
+        case 6: return negamax<6>(pos, log, info, 0, 0, alpha, beta, prune);
+        case 7: return negamax<7>(pos, log, info, 0, 0, alpha, beta, prune);
+        case 8: return negamax<8>(pos, log, info, 0, 0, alpha, beta, prune);
+        case 9: return negamax<9>(pos, log, info, 0, 0, alpha, beta, prune);
+        case 10: return negamax<10>(pos, log, info, 0, 0, alpha, beta, prune);
+        default: return negamax<0>(pos, log, info, 0, 0, alpha, beta, prune);
+        }
+    }
+    /*
+     Negamax: values and the window are from the side to move's view. An
+     extra turn keeps the side, so that child is searched with the same
+     window and no sign flip. With info.pvs every move after the first is
+     searched with a null window first and searched again only if it
+     fails high inside the window. The log gets the root player's view.
+     N is the board size, 0 for any (see state::pits).
+     */
+    template <int N>
+    int negamax(const state &current, log_writer *log, search_info &info, const int depth, const int ply, int alpha, int beta, const bool prune) const {
+        assert(depth >= 0 && depth <= cutoff);
+        int v = -MAX_INT;
+        int cand[MAX_PIT];
+        int nc = current.candidates<N>(cand);
+        info.pv_len[ply] = 0;
+        if (info.check()) {
+            return 0;
+        }
+        int exact = 0;
+        bool solved = egdb_probe(current, depth, ply, exact);
+        STAT(
+            ++info.counters.depth_nodes[min(depth, MAX_DEPTH)];
+            info.chain[ply] = (ply > 0 && current.who == current.whom)? info.chain[ply - 1] + 1: 0;
+            info.counters.longest_chain = max(info.counters.longest_chain, info.chain[ply]);
+        );
+
+        int stand = eval<N>(current, current.who);
+        if ((current.who != current.whom && depth == cutoff) || nc == 0 || (ply != 0 && abs(stand) == WINNING) || solved || ply == MAX_PLY - 1) {
+            info.horizon |= current.who != current.whom && depth == cutoff;
+            STAT(++info.counters.leaves; info.counters.egdb_hits += solved);
+            v = solved? exact: stand;
+            if (info.quiesce && !solved && current.who != current.whom && depth == cutoff && nc > 0 && abs(stand) != WINNING) {
+                int budget = QUIESCE_NODES;
+                v = quiesce<N>(current, info, ply, alpha, beta, stand, budget);
+                if (info.stop) {
+                    return 0;
+                }
+            }
+            log_node(log, current, depth, v, alpha, beta);
+            return v;
+        }
+        log_node(log, current, depth, v, alpha, beta);
+
+        int alpha0 = alpha, beta0 = beta;
+        int best_move = -1;
+        int tt_move = -1;
+        if (info.tt && tt_probe(info, current, depth, alpha, beta, v, tt_move)) {
+            return v;
+        }
+        int delta_depth = current.whom != current.who;
+        //Razoring: two turns from the horizon, far below alpha. Not where the endgame database may answer a leaf instead
+        if (info.razor && prune && ply > 0 && alpha + 1 == beta && depth + delta_depth == cutoff - 1 && stand + RAZOR_MARGIN <= alpha
+            && !(opt.egdb && opt.egdb->stones(n))) {
+            int budget = QUIESCE_NODES;
+            int q = quiesce<N>(current, info, ply, alpha, beta, stand, budget);
+            if (info.stop) {
+                return 0;
+            }
+            if (q <= alpha) {
+                STAT(++info.counters.razored);
+                return q;
+            }
+        }
+        if (info.ordering) {
+            order_moves<N>(info, current, ply, cand, nc, tt_move);
+        } else {
+            order_first(cand, nc, tt_move);
+        }
+        if (ply == 0 && info.root_shift) {
+            rotate(cand, cand + info.root_shift % nc, cand + nc);
+        }
+
+        for (int i = 0; i < nc; ++i) {
+            int e = cand[i];
+            STAT(info.counters.captures += current.capture<N>(e) > 0);
+            state next = current;
+            next.play<N>(e);
+            STAT(info.counters.extra_turns += next.who == current.who);
+            if (info.ordering) {
+                info.pv_node[ply + 1] = info.pv_node[ply] && ply < info.prev_pv_len && e == info.prev_pv[ply];
+            }
+
+            int val = 0;
+            int d = depth + delta_depth;
+            bool same = next.who == current.who;            //Still player's turn
+            /*
+             Futility: a leaf is worth at most its evaluation, quiescence only
+             lets the opponent improve on it, so one that cannot reach alpha
+             is not searched, unless the endgame database knows its real
+             value. Late move reductions: quiet moves after the
+             first LMR_MOVES are searched a turn shallower with a null window,
+             and in full only if that fails high.
+             */
+            if (info.futility && prune && ply > 0 && i > 0 && !same && d == cutoff && !(opt.egdb && opt.egdb->covers(next))) {
+                int s = eval<N>(next, current.who);
+                if (s + FUTILITY_MARGIN <= alpha) {
+                    STAT(++info.counters.futile);
+                    v = max(v, s);
+                    continue;
+                }
+            }
+            bool full = true;
+            if (info.lmr && prune && ply > 0 && i >= LMR_MOVES && !same && cutoff - d >= LMR_DEPTH && current.capture<N>(e) == 0) {
+                STAT(++info.counters.reductions);
+                val = -negamax<N>(next, log, info, d + 1, ply + 1, -alpha - 1, -alpha, prune);
+                full = val > alpha && !info.stop;
+                STAT(info.counters.reduction_fails += full);
+            }
+            if (full && info.pvs && prune && i > 0 && alpha + 1 < beta) {
+                val = same? negamax<N>(next, log, info, d, ply + 1, alpha, alpha + 1, prune): -negamax<N>(next, log, info, d, ply + 1, -alpha - 1, -alpha, prune);
+                if (val > alpha && val < beta && !info.stop) {
+                    STAT(++info.counters.researches);
+                    val = same? negamax<N>(next, log, info, d, ply + 1, alpha, beta, prune): -negamax<N>(next, log, info, d, ply + 1, -beta, -alpha, prune);
+                }
+            } else if (full) {
+                val = same? negamax<N>(next, log, info, d, ply + 1, alpha, beta, prune): -negamax<N>(next, log, info, d, ply + 1, -beta, -alpha, prune);
+            }
+            if (info.stop) {
+                return 0;
+            }
+            if (val > v) {
+                v = val;
+                best_move = e;
+                info.update_pv(ply, e);
+            }
+            if (prune) {
+                if (v >= beta) {
+                    STAT(++info.counters.cutoffs; ++info.counters.cutoff_at[i]);
+                    if (info.ordering) {
+                        record_cutoff<N>(info, current, ply, e, depth);
+                    }
+                    log_node(log, current, depth, v, alpha, beta);
+                    if (info.tt) {
+                        tt_store(info, current, depth, v, alpha0, beta0, best_move);
+                    }
+                    return v;
+                }
+                alpha = max(alpha, v);
+            }
+            log_node(log, current, depth, v, alpha, beta);
+        }
+        if (info.tt) {
+            tt_store(info, current, depth, v, alpha0, beta0, best_move);
+        }
+        return v;
+    }
+    /*
+     Quiescence past the horizon: the side to move stands pat on the
+     evaluation or plays a capture or an extra turn, until the position is
+     quiet or the horizon node's budget of QUIESCE_NODES is spent.
+     */
+    template <int N>
+    int quiesce(const state &current, search_info &info, const int ply, int alpha, const int beta, const int stand, int &budget) const {
+        int v = stand;
+        if (v >= beta || ply >= MAX_PLY - 1) {
+            return v;
+        }
+        alpha = max(alpha, v);
+        int cand[MAX_PIT];
+        int nc = current.candidates<N>(cand);
+        for (int i = 0; i < nc && budget > 0; ++i) {
+            int e = cand[i];
+            if (!current.extra_turn<N>(e) && current.capture<N>(e) == 0) {
+                continue;
+            }
+            if (info.check()) {
+                return 0;
+            }
+            --budget;
+            STAT(++info.counters.qnodes);
+            state next = current;
+            next.play<N>(e);
+            int s = eval<N>(next, next.who);
+            int val;
+            if (next.who == current.who) {
+                val = (abs(s) == WINNING)? s: quiesce<N>(next, info, ply + 1, alpha, beta, s, budget);
+            } else {
+                val = -((abs(s) == WINNING)? s: quiesce<N>(next, info, ply + 1, -beta, -alpha, s, budget));
+            }
+            if (info.stop) {
+                return 0;
+            }
+            if (val > v) {
+                v = val;
+                if (v >= beta) {
+                    return v;
+                }
+                alpha = max(alpha, v);
+            }
+        }
+        return v;
+    }
+    void log_node(log_writer *log, const state &s, const int depth, const int v, const int alpha, const int beta) const {
+        if (!log) {
+            return;
+        }
+        auto root = [](const int x) {               //-MAX_INT is the search's -Infinity
+            return (x == -MAX_INT)? MIN_INT: x;
+        };
+        if (s.who == pos.who) {
+            log->node(s, depth, root(v), root(alpha), root(beta));
+        } else {
+            log->node(s, depth, root(-v), root(-beta), root(-alpha));
+        }
+    }
+
+    string get_pit_name(const int k) const {
+        if (k < n) {
+            return "B" + to_string(k + 2);
+        } else {
+            return "A" + to_string(m - k + 1);
+        }
+    }
+    vector <string> get_pit_name(const vector <int> &v) const {
+        vector <string> ret;
+        for (auto e: v) {
+            ret.push_back(get_pit_name(e));
+        }
+        return ret;
+    }
+    /*
+    string get_node_name(const int k) const {
+        if (k < n) {
+            return "B" + to_string(k + 2);
+        } else {
+            return "A" + to_string(m - k + 1);
+        }
+    }
+
+    */
+    void reset() {                  //Reset a node as a root
+        pos.last_move = -1;
+        pos.whom = (pos.who == player1)? player2: player1;
+    }
+};
+
+/*
+ Lazy SMP scaling: every case of the input searched as a competition
+ position to the same depth with 1, 2, 4, 8 and 16 threads.
+ */
+void bench_threads(istream &fin, const int depth, const size_t hash_mb, search_options opt) {
+    vector <input_case> cases;
+    input_case c;
+    while (read_case(fin, c)) {
+        cases.push_back(c);
+    }
+    trans_table tt(hash_mb);
+    double base = 0;
+    cout << "Threads        Nodes     Time(s)     Nodes/s  Speedup" << endl;
+    for (int t = 1; t <= 16; t <<= 1) {
+        long long nodes = 0;
+        double elapsed = 0;
+        for (auto &e: cases) {
+            board b(TASK_COMPETITION, 0, e.who, e.p2, e.p1, e.man2, e.man1);
+            tt.clear();
+            b.use_table(&tt);
+            opt.threads = t;
+            b.set_options(opt);
+            search_report r = b.analyse(depth > 0? depth: b.depth());
+            nodes += r.nodes;
+            elapsed += r.depth_time.empty()? r.elapsed: r.depth_time.back();
+        }
+        if (t == 1) {
+            base = elapsed;
+        }
+        cout << fixed << setprecision(3) << setw(7) << t << setw(13) << nodes << setw(12) << elapsed
+             << setw(12) << setprecision(0) << nodes / max(elapsed, 1e-9)
+             << setw(9) << setprecision(2) << base / max(elapsed, 1e-9) << endl;
+    }
+    cout.unsetf(ios::fixed);
+}
+
+/*
+ Nodes to the same depth without and with move ordering, one thread
+ */
+void bench_ordering(istream &fin, const int depth, const size_t hash_mb, search_options opt) {
+    trans_table tt(hash_mb);
+    input_case c;
+    long long tot[2] = {0, 0};
+    int k = 0;
+    opt.threads = 1;
+    cout << "Case  Depth    Unordered      Ordered   Ratio" << endl;
+    while (read_case(fin, c)) {
+        long long nodes[2];
+        int d = 0;
+        for (int on = 0; on < 2; ++on) {
+            board b(TASK_COMPETITION, 0, c.who, c.p2, c.p1, c.man2, c.man1);
+            tt.clear();
+            b.use_table(&tt);
+            opt.ordering = on;
+            b.set_options(opt);
+            d = depth > 0? depth: b.depth();
+            nodes[on] = b.analyse(d).nodes;
+            tot[on] += nodes[on];
+        }
+        cout << fixed << setprecision(3) << setw(4) << k++ << setw(7) << d << setw(13) << nodes[0] << setw(13) << nodes[1]
+             << setw(8) << (double) nodes[1] / max(nodes[0], 1LL) << endl;
+    }
+    cout << " All" << setw(7) << "" << setw(13) << tot[0] << setw(13) << tot[1] << setw(8) << (double) tot[1] / max(tot[0], 1LL) << endl;
+    cout.unsetf(ios::fixed);
+}
+
+/*
+ Selectivity benchmark: each case to the same depth with the full search
+ and with the selective one (the features on the command line, all of
+ them if none), on one thread. Prints the nodes saved, what each feature
+ did and whether the move and value stayed the same.
+ */
+void bench_selective(istream &fin, const int depth, const size_t hash_mb, search_options opt) {
+    trans_table tt(hash_mb);
+    input_case c;
+    long long tot[2] = {0, 0};
+    int k = 0, same_move = 0, same_value = 0;
+    opt.threads = 1;
+    opt.verbose = false;
+    opt.stats = STATS_TEXT;
+    if (!opt.lmr && !opt.futility && !opt.razor) {
+        opt.lmr = opt.futility = opt.razor = true;
+    }
+    cout << "Case  Pits  Depth         Full    Selective   Ratio  Reduced  Again%   Futile  Razored  Move  Value" << endl;
+    while (read_case(fin, c)) {
+        board b(TASK_COMPETITION, 0, c.who, c.p2, c.p1, c.man2, c.man1);
+        if (b.game_over()) {
+            continue;
+        }
+        search_report r[2];
+        int d = depth > 0? depth: b.depth();
+        for (int on = 0; on < 2; ++on) {
+            search_options o = opt;
+            o.lmr = on && opt.lmr;
+            o.futility = on && opt.futility;
+            o.razor = on && opt.razor;
+            tt.clear();
+            b.use_table(&tt);
+            b.set_options(o);
+            r[on] = b.analyse(d);
+            tot[on] += r[on].nodes;
+        }
+        const search_stats &s = r[1].counters;
+        bool move = !r[0].pv.empty() && !r[1].pv.empty() && r[0].pv[0] == r[1].pv[0];
+        same_move += move;
+        same_value += r[0].val == r[1].val;
+        cout << fixed << setprecision(3) << setw(4) << k++ << setw(6) << b.size() << setw(7) << d << setw(13) << r[0].nodes
+             << setw(13) << r[1].nodes << setw(8) << (double) r[1].nodes / max(r[0].nodes, 1LL) << setw(9) << s.reductions
+             << setw(8) << setprecision(1) << 100.0 * s.reduction_fails / max(s.reductions, 1LL) << setw(9) << s.futile
+             << setw(9) << s.razored << setw(6) << (move? "same": "diff") << setw(7) << r[1].val - r[0].val << endl;
+    }
+    cout << " All" << setw(13) << "" << setw(13) << tot[0] << setw(13) << tot[1] << setw(8) << setprecision(3)
+         << (double) tot[1] / max(tot[0], 1LL) << ", same move " << same_move << "/" << k << ", same value " << same_value << "/" << k << endl;
+    cout.unsetf(ios::fixed);
+}
+
+/*
+ Batch mode: every case of the input (a file or stdin, text cases or
+ binary positions), one JSON line each on out, in input order. Up to jobs
+ cases are searched at once, each job with its own transposition table,
+ cleared for every case so that the results do not depend on the jobs.
+ next_case is called under the lock.
+ */
+string batch_record(const int k, const input_case &c, const bool fixed_depth, const search_options &opt, trans_table &tt) {
+    ostringstream out;
+    out << "{\"case\":" << k << ",\"task\":" << c.task << ",\"player\":" << c.who;
+    int s1 = accumulate(c.p1.begin(), c.p1.end(), 0);
+    int s2 = accumulate(c.p2.begin(), c.p2.end(), 0);
+    if (c.p1.empty() || c.p1.size() != c.p2.size() || c.p1.size() > MAX_PIT || s1 == 0 || s2 == 0) {
+        out << ",\"error\":\"" << (s1 == 0 || s2 == 0? "game over": "bad board") << "\"}";
+        return out.str();
+    }
+
+    search_clock::time_point start = search_clock::now();
+    board b(c.task, c.cutoff, c.who, c.p2, c.p1, c.man2, c.man1);
+    tt.clear();                             //Each case alone, whatever the job ran before
+    b.use_table(&tt);
+    b.set_options(opt);
+    if ((c.task == TASK_COMPETITION || c.task == TASK_MCTS) && !fixed_depth) {
+        b.set_clock(c.time_remain);
+    }
+    vector <string> moves;
+    search_report r;
+    board next = b.move(moves, nullptr, &r);
+    double ms = chrono::duration<double, milli>(search_clock::now() - start).count();
+
+    string state = next.to_str();
+    replace(state.begin(), state.end(), '\n', '/');
+    out << ",\"moves\":[";
+    for (size_t i = 0; i < moves.size(); ++i) {
+        out << (i? ",": "") << "\"" << moves[i] << "\"";
+    }
+    out << "],\"value\":" << r.val << ",\"depth\":" << r.depth << ",\"nodes\":" << r.nodes
+        << ",\"ms\":" << fixed << setprecision(3) << ms << ",\"next\":\"" << state << "\"";
+    if (opt.stats) {
+        out << ",\"stats\":";
+        print_stats(out, r, true);
+    }
+    out << "}";
+    return out.str();
+}
+
+void run_batch(const function <bool (input_case &)> &next_case, ostream &out, const size_t hash_mb, const int tt_replace,
+               const bool fixed_depth, const search_options &opt, const int jobs) {
+    mutex lock;
+    int next_in = 0, next_out = 0;
+    map <int, string> done;                 //Finished out of order
+
+    auto worker = [&]() {
+        trans_table tt(hash_mb, tt_replace);
+        input_case c;
+        while (true) {
+            int k;
+            {
+                lock_guard <mutex> guard(lock);
+                if (!next_case(c)) {
+                    return;
+                }
+                k = next_in++;
+            }
+            string rec = batch_record(k, c, fixed_depth, opt, tt);
+            lock_guard <mutex> guard(lock);
+            done[k] = rec;
+            for (auto it = done.find(next_out); it != done.end(); it = done.find(next_out)) {
+                out << it->second << '\n';
+                done.erase(it);
+                ++next_out;
             }
-            
-            //If NOT end up in own mancala, FLIP
-            t.flip_player();
+            out.flush();
         }
-        t.end_game_collect();
-        t.update_candidate();
-        return t;                               //Change turn;
+    };
+
+    vector <thread> workers;
+    for (int i = 1; i < jobs; ++i) {
+        workers.push_back(thread(worker));
     }
-    
-    bool game_over() const {                                //Game over
-        //return accumulate(position.begin(), position.end(), 0) == 0;
-        int m1, m2;
-        m1 = accumulate(position.begin(), position.begin() + n, 0);
-        m2 = accumulate(position.begin() + n, position.end(), 0);
-        return (m1 == 0) || (m2 == 0);
+    worker();
+    for (auto &t: workers) {
+        t.join();
     }
-    void end_game_collect() {
-        if (game_over()) {
-            man1 += accumulate(position.begin(), position.begin() + n, 0);
-            man2 += accumulate(position.begin() + n, position.end(), 0);
-            position.clear();
-            position = vector<int>(m, 0);
-        }
+}
+
+/*
+ The position commands of server and host mode, after the word position:
+   start <pits> <stones> [moves <pit>...]
+   <player> <man2> <man1> <player 2 pits> <player 1 pits> [moves <pit>...]
+ Numbers past MAX_POSITION_STONES are refused with the rest of the bad
+ input, so that no total overflows.
+ */
+#define MAX_POSITION_STONES 1000000
+
+inline bool read_position(stringstream &ss, board &out) {
+    string t;
+    vector <string> words;
+    while (ss >> t && t != "moves") {
+        words.push_back(t);
     }
-    
-private:                        //Private methods
-    
-    int eval(player p) const {                    //Evaluation from p's perspective
-        if (p == player1) {
-            return eval();
-        } else {
-            return -eval();
+    vector <int> x;
+    for (size_t i = (words.size() && words[0] == "start")? 1: 0; i < words.size(); ++i) {
+        char *end = nullptr;
+        errno = 0;
+        long v = strtol(words[i].c_str(), &end, 10);
+        if (words[i].find_first_not_of("0123456789") != string::npos || *end || errno || v > MAX_POSITION_STONES) {
+            return false;
         }
+        x.push_back((int) v);
     }
-    int eval() const {                            //Who stands better?
-        if (task != TASK_COMPETITION) {
-            return man1 - man2;
-        } else {
-            return (int) round(eval_comp());
+    vector <int> p1, p2;
+    int who, man1, man2;
+    if (words.size() && words[0] == "start") {
+        if (x.size() != 2 || x[0] < 3 || x[0] > MAX_PIT || x[1] < 1) {
+            return false;
         }
-    }
-    double eval_comp() const {                       //From Player1's perspective
-        double score = 0;
-        int piece1 = accumulate(position.begin(), position.begin() + n, 0);
-        int piece2 = accumulate(position.begin() + n, position.end(), 0);
-        int t = piece1 + piece2;
-        if (man1 - man2 > t) {                       //Winning position for 1
-            return WINNING;
+        p1 = p2 = vector <int> (x[0], x[1]);
+        who = 1;
+        man1 = man2 = 0;
+    } else {
+        int n = ((int) x.size() - 3) / 2;
+        if (n < 3 || n > MAX_PIT || (int) x.size() != 3 + 2 * n || x[0] < 1 || x[0] > 2) {
+            return false;
         }
-        if (man2 - man1 > t) {                       //Winning position for 2
-            return LOSING;
+        who = x[0];
+        man2 = x[1];
+        man1 = x[2];
+        p2.assign(x.begin() + 3, x.begin() + 3 + n);
+        p1.assign(x.begin() + 3 + n, x.end());
+    }
+    if (accumulate(p1.begin(), p1.end(), 0) == 0 || accumulate(p2.begin(), p2.end(), 0) == 0) {
+        return false;
+    }
+    board b(TASK_COMPETITION, 0, who, p2, p1, man2, man1);
+    while (ss >> t) {
+        int k = b.parse_pit(t);
+        vector <int> cand = b.get_candidate();
+        if (b.game_over() || find(cand.begin(), cand.end(), k) == cand.end()) {
+            return false;
         }
-        double man_diff = (man1 - man2) * 2.22;
-        double piece_diff = -(piece1 - piece2) * 0.38;   //Kick as many pieces to the opposite
+        b = b.move(k);
+    }
+    out = b.as_root();
+    return true;
+}
 
-        vector<int> weight = {2, 1, 0, 0, -1, -2};
+/*
+ Server mode: a persistent engine taking one command per line on stdin
+ and answering on stdout, in the manner of UCI.
+   position <player> <man2> <man1> <player 2 pits> <player 1 pits> [moves <pit>...]
+   position start <pits> <stones> [moves <pit>...]
+   go [depth <d>] [movetime <ms>] [time <s>] [movestogo <n>] [infinite] [ponder]
+   stop, ponderhit, isready, newgame, quit
+   setoption <name> <value>      threads, hash, ordering, pvs, latency, movestogo, ponder
+ A search runs in the background: "info" after each iteration, then
+ "bestmove" with every pit of the turn. Other commands wait for it unless
+ it is infinite or pondering: those hold their bestmove until stop, or
+ ponderhit which starts the clock. The transposition table and the
+ history stay warm between moves; newgame clears them. latency (ms,
+ default 50) is kept back from every time limit.
 
-        double weight1;
-        double weight2;
-        /*
-            Weight:
-            2 1 0 0 -1 -2
-            2 1 0 0 -1 -2
-        */
+ With the ponder option the engine ponders by itself: after the bestmove
+ of a timed search it plays the opponent's turn predicted by the PV and
+ keeps searching the position that follows. If the next position is the
+ predicted one the search goes on and the next timed go only gives it the
+ rest of its slice; otherwise it is dropped at once. Hits and the clock
+ time saved are reported on newgame and quit.
+ */
+class engine_server {
+private:
+    search_options opt;
+    trans_table tt;
+    move_history hist;
+    board pos;
+    bool ready;                         //A position was set
+    int latency;
+    bool auto_ponder;
+    thread worker, timer;
+    mutex lock;                         //Guards the worker's hand-over between searches
+    atomic <bool> stop_signal;
+    atomic <bool> holding;              //infinite or ponder: no bestmove before stop
+    atomic <bool> searching;
+    atomic <int> generation;            //Counts the searches, so a timer stops only its own
+    bool quitting;                      //The worker must not start another search
+    bool pondering;                     //Searching a predicted position, no hit yet
+    bool ponder_hit;                    //The prediction came true, waiting for go
+    state predicted;
+    search_clock::time_point ponder_start;
+    double ponder_time;                 //Seconds to think after ponderhit
+    int ponders, hits;                  //This game
+    double saved;
 
-        score = man_diff + piece_diff;
-        return score;
+    static void say(const string &line) {
+        cout << line + "\n" << flush;
     }
-
-    void update_candidate() {
-        candidate = vector<int>(0);
-        if (who == player1) {
-            for (int k = n - 1; k >= 0; --k) {
-                if (position[k] > 0)
-                    candidate.push_back(k);
+    static bool same_position(const state &a, const state &b) {
+        if (a.n != b.n || a.who != b.who || a.man1 != b.man1 || a.man2 != b.man2) {
+            return false;
+        }
+        return equal(a.pit, a.pit + a.size(), b.pit);
+    }
+    void stop() {
+        {
+            lock_guard <mutex> guard(lock);
+            quitting = true;
+            stop_signal = true;
+            holding = false;
+        }
+        if (worker.joinable()) {
+            worker.join();
+        }
+        if (timer.joinable()) {
+            timer.join();
+        }
+        pondering = ponder_hit = false;
+    }
+    void finish(const bool keep_held = false) {         //Let a bounded search end by itself, without pondering after it
+        bool hold;
+        {
+            lock_guard <mutex> guard(lock);
+            if (keep_held && (holding || pondering || ponder_hit)) {
+                return;                 //Checked under the lock the worker clears pondering with
             }
-        } else {
-            for (int k = m - 1; k >= n; --k) {
-                if (position[k] > 0)
-                    candidate.push_back(k);
+            quitting = true;
+            hold = holding;
+        }
+        if (hold) {
+            stop();
+        }
+        if (worker.joinable()) {
+            worker.join();
+        }
+        if (timer.joinable()) {
+            timer.join();
+        }
+    }
+    void start_timer(const double seconds) {            //Stop the search after seconds
+        if (timer.joinable()) {
+            timer.join();
+        }
+        int gen = generation;
+        timer = thread([this, seconds, gen]() {
+            search_clock::time_point end = search_clock::now() + chrono::duration_cast<search_clock::duration>(chrono::duration<double>(seconds));
+            while (searching && generation == gen && search_clock::now() < end) {
+                this_thread::sleep_for(chrono::milliseconds(1));
             }
+            if (generation == gen) {
+                stop_signal = true;
+            }
+        });
+    }
+    void report_ponder() {
+        if (ponders > 0) {
+            ostringstream line;
+            line << "info string ponder hits " << hits << "/" << ponders << " (" << 100 * hits / ponders << "%), time saved "
+                 << fixed << setprecision(3) << saved << "s";
+            say(line.str());
         }
+        ponders = hits = 0;
+        saved = 0;
     }
-    board move_minimax(vector<string>& the_move, vector <string> &traverse_log, const bool prune, const bool save_log) const {              //prune==false -> no alpha beta
-        board start = *this;
-        board ultimate = max_node(start, traverse_log, 0, prune, MIN_NODE, save_log);//Find optimal
-        cout << "After move: " << get_pit_name(ultimate.history) << ", expected analysis: " << ((ultimate.eval() >= 0)? "+": "") << ultimate.eval() << endl;
-
+    void set_position(stringstream &ss) {
+        board b;
+        if (!read_position(ss, b)) {
+            finish();
+            say("info string bad position");
+            return;
+        }
+        bool hit = false;
+        {
+            lock_guard <mutex> guard(lock);
+            if (pondering) {
+                hit = same_position(b.get_state(), predicted);
+                pondering = !hit;
+                ponder_hit = hit;
+                hits += hit;
+            }
+        }
+        if (!hit) {
+            finish();                   //A miss drops the ponder search at once
+        }
+        pos = b;
+        ready = true;
+    }
+    bool predict(const board &b, const search_report &r, const vector <string> &moves, board &out) const {
+        board next = b;                 //Our turn, then the opponent's from the PV
+        size_t i = 0;
+        for (; i < r.pv.size() && next.turn() == b.turn(); ++i) {
+            next = next.move(r.pv[i]);
+        }
+        if (i != moves.size()) {
+            return false;
+        }
+        for (; i < r.pv.size() && next.turn() != b.turn() && !next.game_over(); ++i) {
+            next = next.move(r.pv[i]);
+        }
+        if (next.turn() != b.turn() || next.game_over()) {
+            return false;               //The PV stops inside the opponent's turn
+        }
+        out = next.as_root();
+        return true;
+    }
+    void search(board b, double slice, double hard, int max_depth) {
+        const bool timed = slice > 0;   //The go's own clock; a ponder search after it has none
+        while (true) {
+            search_report r = b.think(slice, hard, max_depth);
+            while (holding && !stop_signal) {
+                this_thread::sleep_for(chrono::milliseconds(1));
+            }
+            {
+                lock_guard <mutex> guard(lock);
+                if (pondering) {        //Missed or stopped before the opponent moved
+                    pondering = false;
+                    break;
+                }
+            }
+            vector <string> moves;
+            b.play(r, moves);
+            string line = "bestmove";
+            for (auto &e: moves) {
+                line += " " + e;
+            }
+            say(line);
 
-        board next = *this;    //Make the decision
-        for (auto e: ultimate.history) {
-            next = next.move(e);
-            the_move.push_back(get_pit_name(e));
-            if (who != next.turn()) {
+            lock_guard <mutex> guard(lock);
+            if (!auto_ponder || !timed || quitting || !predict(b, r, moves, b)) {
                 break;
             }
+            predicted = b.get_state();
+            ++generation;
+            pondering = true;
+            holding = true;
+            stop_signal = false;
+            ponder_start = search_clock::now();
+            ++ponders;
+            slice = hard = 0;
+            max_depth = MAX_DEPTH;
         }
-
-        next.reset();                                   //Reset the new node as a root
-        return next;
+        searching = false;
     }
-    /*
-     MINIMAX function
-     */
-    board max_node(board &current, vector <string> &traverse_log, const int depth, const bool prune, const node from, const bool save_log) const {
-        assert(depth >= 0 && depth <= cutoff);
-        //cout << get_node_name(current) << endl;
-        
-        int v = MIN_INT;
-        
-        /*if (depth == cutoff) {
-            v = current.eval(who);
-        }*/
-        
-        board best = current;
-        
-        if ((current.who != current.whom && depth == cutoff) || !current.has_legal_move() || (!current.is_root && abs(current.eval(who)) == WINNING)) {
-            best.val = current.eval(who);
-            if (save_log) {
-                traverse_log.push_back(log_string(current, depth, best.val, prune));
+    void go(stringstream &ss) {
+        string t;
+        int depth = 0, moves_to_go = opt.moves_to_go;
+        double movetime = 0, clock = 0;
+        bool infinite = false, ponder = false;
+        while (ss >> t) {
+            if (t == "depth") {
+                ss >> depth;
+            } else if (t == "movetime") {
+                ss >> movetime;
+                movetime /= 1000;
+            } else if (t == "time") {
+                ss >> clock;
+            } else if (t == "movestogo") {
+                ss >> moves_to_go;
+            } else if (t == "infinite") {
+                infinite = true;
+            } else if (t == "ponder") {
+                ponder = true;
             }
-            return best;
         }
-        if (save_log) {
-            traverse_log.push_back(log_string(current, depth, v, prune));
+        double margin = latency / 1000.0;
+        double slice = 0, hard = 0;
+        if (movetime > 0) {
+            slice = hard = max(movetime - margin, 0.001);
+        } else if (clock > 0) {
+            slice = clock / max(moves_to_go, 1);
+            hard = max(min(min(slice * 3, clock / 4), clock - margin), 0.001);
         }
-        
-        for (auto e: current.candidate) {
-            board next = current.move(e);
-            next.history.push_back(e);
-            
-            int delta_depth = current.whom != current.who;
-            
-            if (depth == cutoff && delta_depth) {
-                best.val = current.eval(who);
-                return best;
+
+        if (ponder_hit && slice > 0 && !infinite && !ponder && depth == 0) {
+            double elapsed = chrono::duration<double>(search_clock::now() - ponder_start).count();
+            ponder_hit = false;
+            saved += min(elapsed, slice);
+            holding = false;
+            start_timer(max(slice - elapsed, 0.0));     //The ponder search already had elapsed
+            return;
+        }
+        if (ponder_hit) {               //Not a timed go: search it afresh
+            lock_guard <mutex> guard(lock);
+            pondering = true;
+        }
+        if (holding) {
+            stop();
+        }
+        finish();
+        ponder_hit = false;
+        if (!ready || pos.game_over()) {
+            say("bestmove none");
+            return;
+        }
+        int max_depth = (depth > 0)? min(depth, MAX_DEPTH): (slice > 0 || infinite || ponder)? MAX_DEPTH: pos.depth();
+        ponder_time = hard;
+        if (infinite || ponder) {
+            slice = hard = 0;
+        }
+
+        board b = pos;
+        search_options o = opt;
+        o.stop_signal = &stop_signal;
+        o.uci = true;
+        o.verbose = true;
+        b.use_table(&tt);
+        b.use_history(&hist);
+        b.set_options(o);
+        search_report r;
+        if (!infinite && !ponder && b.book_turn(r)) {
+            vector <string> moves;
+            b.play(r, moves);
+            string line = "info string book depth " + to_string(r.depth) + "\nbestmove";
+            for (auto &e: moves) {
+                line += " " + e;
             }
-            
-            if (next.whom == next.who) {            //Still player's turn
-                next = max_node(next, traverse_log, depth + delta_depth, prune, MAX_NODE, save_log);
-            } else {
-                next = min_node(next, traverse_log, depth + delta_depth, prune, MAX_NODE, save_log);
+            say(line);
+            return;
+        }
+        stop_signal = false;
+        holding = infinite || ponder;
+        searching = true;
+        quitting = false;
+        ++generation;
+        worker = thread(&engine_server::search, this, b, slice, hard, max_depth);
+    }
+    void set_option(stringstream &ss) {
+        string name;
+        long long value = 0;
+        ss >> name >> value;
+        if (ss.fail()) {
+            say("info string bad option");
+        } else if (name == "threads") {
+            opt.threads = max((int) value, 1);
+        } else if (name == "hash") {
+            tt.resize(max(value, 0LL));
+        } else if (name == "ordering") {
+            opt.ordering = value != 0;
+        } else if (name == "pvs") {
+            opt.pvs = value != 0;
+        } else if (name == "latency") {
+            latency = max((int) value, 0);
+        } else if (name == "movestogo") {
+            opt.moves_to_go = max((int) value, 1);
+        } else if (name == "ponder") {
+            auto_ponder = value != 0;
+        } else {
+            say("info string unknown option " + name);
+        }
+    }
+
+public:
+    engine_server(const size_t hash_mb, const int tt_replace, const search_options &opt1) : opt(opt1), tt(hash_mb, tt_replace) {
+        ready = false;
+        latency = 50;
+        auto_ponder = false;
+        stop_signal = false;
+        holding = false;
+        searching = false;
+        generation = 0;
+        quitting = false;
+        pondering = ponder_hit = false;
+        ponder_time = 0;
+        ponders = hits = 0;
+        saved = 0;
+    }
+    ~engine_server() {
+        stop();
+    }
+    void run(istream &in) {
+        string line;
+        while (getline(in, line)) {
+            stringstream ss(line);
+            string cmd;
+            if (!(ss >> cmd)) {
+                continue;
             }
-            if (next.val > v) {
-                v = next.val;
-                best = next;
+            if (cmd == "quit") {
+                break;
+            } else if (cmd == "isready") {
+                finish(true);
+                say("readyok");
+            } else if (cmd == "position") {
+                set_position(ss);
+            } else if (cmd == "go") {
+                go(ss);
+            } else if (cmd == "stop") {
+                stop();
+            } else if (cmd == "ponderhit") {
+                holding = false;
+                if (searching) {
+                    start_timer(ponder_time);
+                }
+            } else if (cmd == "newgame") {
+                stop();
+                report_ponder();
+                tt.clear();
+                hist.clear();
+            } else if (cmd == "setoption") {
+                set_option(ss);
+            } else {
+                say("info string unknown command " + cmd);
             }
-            if (prune) {
-                if (best.val >= current.beta) {
+        }
+        stop();
+        report_ponder();
+    }
+};
 
-                    if (save_log) {
-                        traverse_log.push_back(log_string(current, depth, v, prune));
-                    }
-                    return best;
+/*
+ Host mode: many games at once on one pool of searches. Every line but
+ stats and quit starts with the name of a game:
+   <game> position ...          as in server mode
+   <game> go [time <s>] [movestogo <n>] [depth <d>]
+   <game> end                   forget the game, report its latency (after
+                                its bestmove if a search is under way)
+   stats                        latency of every game
+   setoption latency <ms>       kept back from every limit (default 50)
+   quit                         after the queued searches
+ The answer is "<game> bestmove <pits>". Searches wait in one queue and
+ jobs workers run them one thread each, so the host never runs more of
+ them than it was given cores. The queue is earliest deadline first: a
+ go's deadline is its arrival plus its slice of the game's clock
+ (time / movestogo), so a game short of time goes ahead, and the wait is
+ taken out of the slice. All games share one transposition table of
+ --hash MiB, which bounds the memory whatever their number; each keeps
+ its own move history. Latency is from the go line to the bestmove, in
+ percentiles per game.
+ */
+struct host_game {
+    board pos;
+    bool ready;                         //A position was set
+    bool busy;                          //A go is queued or searching
+    bool closing;                       //Ended while busy: its worker forgets it
+    move_history hist;
+    vector <double> latency;            //Milliseconds, per go
+    double waited;                      //Milliseconds in the queue, all goes
+
+    host_game() : ready(false), busy(false), closing(false), waited(0) {
+    }
+};
+
+struct host_request {
+    string game;
+    board pos;
+    double slice, hard;                 //Seconds from arrival
+    int max_depth;
+    search_clock::time_point arrival, deadline;
+
+    bool operator<(const host_request &o) const {   //Latest deadline at the bottom of the heap
+        return deadline > o.deadline;
+    }
+};
+
+class match_host {
+private:
+    search_options opt;
+    trans_table tt;
+    int jobs;
+    int latency;                        //Milliseconds kept back from every limit
+    map <string, host_game> games;
+    priority_queue <host_request> queue;
+    mutex lock;                         //Guards games and queue
+    mutex out_lock;
+    condition_variable wake;            //Queue changed or quitting
+    bool quitting;
+    vector <thread> workers;
+
+    void say(const string &line) {
+        lock_guard <mutex> guard(out_lock);
+        cout << line + "\n" << flush;
+    }
+    static double percentile(const vector <double> &sorted, const double p) {
+        if (sorted.empty()) {
+            return 0;
+        }
+        size_t i = (size_t) ceil(p * sorted.size());
+        return sorted[min(max(i, (size_t) 1), sorted.size()) - 1];
+    }
+    string latency_line(const string &name, vector <double> v, const double waited) const {
+        sort(v.begin(), v.end());
+        ostringstream line;
+        line << name << " info string latency moves " << v.size() << fixed << setprecision(1)
+             << " p50 " << percentile(v, 0.5) << " p90 " << percentile(v, 0.9) << " p99 " << percentile(v, 0.99)
+             << " max " << (v.empty()? 0: v.back()) << " ms, queued " << waited / max(v.size(), (size_t) 1) << " ms per move";
+        return line.str();
+    }
+    void work() {
+        while (true) {
+            host_request req;
+            move_history *hist;
+            {
+                unique_lock <mutex> guard(lock);
+                wake.wait(guard, [this]() {
+                    return !queue.empty() || quitting;
+                });
+                if (queue.empty()) {
+                    return;
+                }
+                req = queue.top();
+                queue.pop();
+                hist = &games[req.game].hist;
+            }
+            double waited = chrono::duration<double>(search_clock::now() - req.arrival).count();
+            board b = req.pos;
+            b.use_table(&tt);
+            b.use_history(hist);
+            b.set_options(opt);
+            search_report r;
+            if (!b.book_turn(r)) {
+                double slice = 0, hard = 0;
+                if (req.slice > 0) {
+                    slice = max(req.slice - waited, 0.001);
+                    hard = max(req.hard - waited, 0.001);
                 }
-                current.alpha = max(current.alpha, best.val);
+                r = b.think(slice, hard, req.max_depth);
+            }
+            vector <string> moves;
+            b.play(r, moves);
+            string line = req.game + " bestmove";
+            for (auto &e: moves) {
+                line += " " + e;
             }
-            //cout << get_node_name(current) << endl;
 
-            if (save_log) {
-                traverse_log.push_back(log_string(current, depth, v, prune));
+            lock_guard <mutex> guard(lock);         //The game is free again once its client has the move
+            host_game &g = games[req.game];
+            g.latency.push_back(chrono::duration<double, milli>(search_clock::now() - req.arrival).count());
+            g.waited += 1000 * waited;
+            say(line);
+            g.busy = false;
+            if (g.closing) {
+                say(latency_line(req.game, g.latency, g.waited));
+                games.erase(req.game);
             }
         }
-        return best;
     }
-    board min_node(board &current, vector <string> &traverse_log, const int depth, const bool prune, const node from, const bool save_log) const {
-        assert(depth >= 0 && depth <= cutoff);
-        //cout << get_node_name(current) << endl;
-        int v = MAX_INT;
-        
-        /*if (depth == cutoff) {
-            v = current.eval(who);
-        }*/
-        
-        board best = current;
-        
-        if ((current.who != current.whom && depth == cutoff) || !current.has_legal_move() || (!current.is_root && abs(current.eval(who)) == WINNING)) {
-            best.val = current.eval(who);
-            if (save_log) {
-                traverse_log.push_back(log_string(current, depth, best.val, prune));
+    void go(const string &name, stringstream &ss) {
+        host_request req;
+        req.arrival = search_clock::now();
+        string t;
+        int depth = 0, moves_to_go = opt.moves_to_go;
+        double clock = 0;
+        bool timed = false;
+        while (ss >> t) {
+            if (t == "depth") {
+                ss >> depth;
+            } else if (t == "time") {
+                ss >> clock;
+                timed = true;
+            } else if (t == "movestogo") {
+                ss >> moves_to_go;
             }
-            return best;
         }
-        if (save_log) {
-            traverse_log.push_back(log_string(current, depth, v, prune));
+        lock_guard <mutex> guard(lock);
+        host_game &g = games[name];
+        if (g.busy) {
+            say(name + " info string busy");
+            return;
+        }
+        if (!g.ready || g.pos.game_over()) {
+            say(name + " bestmove none");
+            return;
         }
+        double margin = latency / 1000.0;
+        req.slice = req.hard = 0;
+        if (timed && depth == 0) {                  //A clock run out still gets a move
+            req.slice = max(clock / max(moves_to_go, 1), 0.001);
+            req.hard = max(min(min(req.slice * 3, clock / 4), clock - margin), 0.001);
+        }
+        req.game = name;
+        req.pos = g.pos;
+        req.max_depth = (depth > 0)? min(depth, MAX_DEPTH): timed? MAX_DEPTH: g.pos.depth();
+        //Without a clock, the deadline is as far as it gets
+        req.deadline = req.arrival + chrono::duration_cast<search_clock::duration>(chrono::duration<double>((req.slice > 0)? req.slice: 1e6));
+        g.busy = true;
+        queue.push(req);
+        wake.notify_all();
+    }
 
-        for (auto e: current.candidate) {
-            board next = current.move(e);
-            next.history.push_back(e);
-            
-            int delta_depth = current.whom != current.who;
-            
-            if (depth == cutoff && delta_depth) {
-                best.val = current.eval(who);
-                return best;
-            }
-            
-            if (next.whom == next.who) {          //Still player's turn
-                next = min_node(next, traverse_log, depth + delta_depth, prune, MIN_NODE, save_log);
-            } else {
-                next = max_node(next, traverse_log, depth + delta_depth, prune, MIN_NODE, save_log);
+public:
+    match_host(const size_t hash_mb, const int tt_replace, const search_options &opt1, const int jobs1) : opt(opt1), tt(hash_mb, tt_replace) {
+        jobs = max(jobs1, 1);
+        latency = 50;
+        quitting = false;
+        opt.threads = 1;
+        opt.verbose = false;
+        opt.stats = 0;
+    }
+    ~match_host() {
+        {
+            lock_guard <mutex> guard(lock);
+            quitting = true;
+        }
+        wake.notify_all();
+        for (auto &t: workers) {
+            if (t.joinable()) {
+                t.join();
             }
-            
-            if (next.val < v) {
-                v = next.val;
-                best = next;
+        }
+    }
+    void run(istream &in) {
+        for (int i = 0; i < jobs; ++i) {
+            workers.push_back(thread(&match_host::work, this));
+        }
+        string line;
+        while (getline(in, line)) {
+            stringstream ss(line);
+            string name, cmd;
+            if (!(ss >> name)) {
+                continue;
             }
-            if (prune) {
-                if (best.val <= current.alpha) {
-                    if (save_log) {
-                        traverse_log.push_back(log_string(current, depth, v, prune));
+            if (name == "quit") {
+                break;
+            } else if (name == "stats") {
+                lock_guard <mutex> guard(lock);
+                vector <double> all;
+                double waited = 0;
+                for (auto &g: games) {
+                    if (g.second.latency.empty()) {
+                        continue;
                     }
-                    return best;
+                    say(latency_line(g.first, g.second.latency, g.second.waited));
+                    all.insert(all.end(), g.second.latency.begin(), g.second.latency.end());
+                    waited += g.second.waited;
                 }
-                current.beta = min(current.beta, best.val);
+                say(latency_line("all", all, waited));
+                continue;
             }
-            if (save_log) {
-                traverse_log.push_back(log_string(current, depth, v, prune));
+            ss >> cmd;
+            if (cmd == "position") {
+                board b;
+                if (!read_position(ss, b)) {
+                    say(name + " info string bad position");
+                    continue;
+                }
+                lock_guard <mutex> guard(lock);
+                host_game &g = games[name];
+                if (g.busy) {
+                    say(name + " info string busy");
+                    continue;
+                }
+                g.pos = b;
+                g.ready = true;
+            } else if (cmd == "go") {
+                go(name, ss);
+            } else if (cmd == "end") {
+                lock_guard <mutex> guard(lock);
+                host_game &g = games[name];
+                if (g.busy) {
+                    g.closing = true;   //Answered after its bestmove, by the worker
+                    continue;
+                }
+                say(latency_line(name, g.latency, g.waited));
+                games.erase(name);
+            } else if (name == "setoption") {
+                long long value = 0;
+                ss >> value;
+                if (cmd == "latency" && !ss.fail()) {
+                    latency = max((int) value, 0);
+                } else {
+                    say("info string bad option");
+                }
+            } else {
+                say(name + " info string unknown command " + cmd);
             }
-            //cout << get_node_name(current) << endl;
         }
-        return best;
+        {
+            lock_guard <mutex> guard(lock);
+            quitting = true;
+        }
+        wake.notify_all();
+        for (auto &t: workers) {
+            t.join();
+        }
+        workers.clear();
     }
+};
 
-    void flip_player() {                //The only mutable variable
-        who = (who == player1)? player2: player1;
-    }
-    bool has_legal_move() const {
-        return !candidate.empty();
-    }
-    bool is_own_pit(const int k) const {
-        if (who == player1) {
-            return k < n;
-        } else {
-            return k >= n;
+/*
+ Offline book generator: every position within plies single sowings of
+ the start of each board ("6x4" is 6 pits of 4 stones), with either player
+ moving first, searched to depth. Up to jobs positions at once, each job
+ with its own transposition table.
+ */
+bool build_book(const string &file, const vector <pair <int, int> > &boards, const int plies, const int depth,
+                const size_t hash_mb, const search_options &opt, const int jobs, ostream &log) {
+    vector <board> todo;
+    set <pair <uint64_t, int> > seen;
+    for (auto &bs: boards) {
+        vector <int> pits(bs.first, bs.second);
+        vector <board> layer;
+        for (int who = 1; who <= 2; ++who) {
+            layer.push_back(board(TASK_COMPETITION, 0, who, pits, pits, 0, 0));
         }
-    }
-    string get_pit_name(const int k) const {
-        if (k < n) {
-            return "B" + to_string(k + 2);
-        } else {
-            return "A" + to_string(m - k + 1);
+        for (int ply = 0; ply <= plies && !layer.empty(); ++ply) {
+            vector <board> next;
+            for (auto &b: layer) {
+                state s = b.get_state();
+                if (b.game_over() || !seen.insert(make_pair(s.hash, s.n)).second) {
+                    continue;
+                }
+                todo.push_back(b.as_root());
+                for (auto k: b.get_candidate()) {
+                    next.push_back(b.move(k));
+                }
+            }
+            layer.swap(next);
         }
     }
-    vector <string> get_pit_name(const vector <int> &v) const {
-        vector <string> ret;
-        for (auto e: v) {
-            ret.push_back(get_pit_name(e));
+    log << todo.size() << " positions to depth " << depth << endl;
+
+    mutex lock;
+    size_t next_in = 0;
+    vector <book_entry> records(todo.size());
+    auto worker = [&]() {
+        trans_table tt(hash_mb);
+        search_options o = opt;
+        o.verbose = false;
+        o.threads = 1;
+        while (true) {
+            size_t i;
+            {
+                lock_guard <mutex> guard(lock);
+                if (next_in == todo.size()) {
+                    return;
+                }
+                i = next_in++;
+            }
+            board b = todo[i];
+            tt.clear();
+            b.use_table(&tt);
+            b.set_options(o);
+            search_report r = b.analyse(depth);
+            state s = b.get_state();
+            book_entry &e = records[i];
+            e.hash = s.hash;
+            e.value = r.val;
+            e.depth = r.depth;
+            e.n = s.n;
+            e.pit = r.pv.empty()? -1: r.pv[0];
         }
-        return ret;
+    };
+    vector <thread> workers;
+    for (int i = 1; i < jobs; ++i) {
+        workers.push_back(thread(worker));
     }
-    /*
-    string get_node_name(const int k) const {
-        if (k < n) {
-            return "B" + to_string(k + 2);
+    worker();
+    for (auto &t: workers) {
+        t.join();
+    }
+    records.erase(remove_if(records.begin(), records.end(), [](const book_entry &e) {
+        return e.pit < 0;
+    }), records.end());
+    log << records.size() << " records" << endl;
+    return opening_book::write(file, records);
+}
+
+#ifndef MYAGENT_NO_MAIN                 //Other programs include the engine
+int main(int argc, char *argv[]) {
+    string inp_file = "input.txt";
+    size_t hash_mb = 16;                //Transposition table budget, 0 disables it
+    int tt_replace = REPLACE_DEPTH;
+    bool fixed_depth = false;           //Ignore the clock, use compute_cutoff
+    search_options opt;
+    bool bench_smp = false;             //Thread scaling benchmark over every case
+    bool bench_order = false;           //Move ordering benchmark over every case
+    bool bench_select = false;          //Selective search against the full one over every case
+    bool batch = false;                 //Every case of the input, one record each
+    bool server = false;                //Commands on stdin until quit
+    bool host = false;                  //Many games' commands on stdin until quit
+    int jobs = 1;                       //Cases searched in parallel by the batch
+    int bench_depth = 0;                //0: compute_cutoff of each case
+    bool binary_log = false;            //traverse_log.bin instead of traverse_log.txt
+    string decode_file;                 //Binary log to print as text
+    string convert_in, convert_out;     //Text cases <-> binary positions
+    string egdb_file = "egdb.bin";      //Endgame database, used if present
+    string eval_file;                   //Evaluation parameters, built-in if empty
+    int egdb_build = 0;                 //Generate it with up to this many stones
+    string book_file = "book.bin";      //Opening book, used if present
+    int book_build = 0;                 //Generate it for positions this many plies deep
+    string book_boards = "4x4,5x4,6x4"; //Starts it covers, pits x stones
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--hash" && i + 1 < argc) {
+            hash_mb = stoi(argv[++i]);
+        } else if (arg == "--tt-replace" && i + 1 < argc) {
+            arg = argv[++i];
+            tt_replace = (arg == "always")? REPLACE_ALWAYS: REPLACE_DEPTH;
+        } else if (arg == "--fixed-depth") {
+            fixed_depth = true;
+        } else if (arg == "--moves-to-go" && i + 1 < argc) {
+            opt.moves_to_go = stoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            opt.threads = stoi(argv[++i]);
+        } else if (arg == "--bench-smp") {
+            bench_smp = true;
+        } else if (arg == "--bench-order") {
+            bench_order = true;
+        } else if (arg == "--batch") {
+            batch = true;
+        } else if (arg == "--server") {
+            server = true;
+        } else if (arg == "--host") {
+            host = true;
+        } else if (arg == "--jobs" && i + 1 < argc) {
+            jobs = stoi(argv[++i]);
+        } else if (arg == "--stats") {
+            opt.stats = STATS_TEXT;
+            if (i + 1 < argc && string(argv[i + 1]) == "json") {
+                opt.stats = STATS_JSON;
+                ++i;
+            }
+        } else if (arg == "--no-ordering") {
+            opt.ordering = false;
+        } else if (arg == "--no-pvs") {
+            opt.pvs = false;
+        } else if (arg == "--no-quiesce") {
+            opt.quiesce = false;
+        } else if (arg == "--no-specialize") {
+            opt.specialize = false;
+        } else if (arg == "--lmr") {
+            opt.lmr = true;
+        } else if (arg == "--futility") {
+            opt.futility = true;
+        } else if (arg == "--razor") {
+            opt.razor = true;
+        } else if (arg == "--bench-select") {
+            bench_select = true;
+        } else if (arg == "--binary-log") {
+            binary_log = true;
+        } else if (arg == "--decode-log" && i + 1 < argc) {
+            decode_file = argv[++i];
+        } else if (arg == "--convert" && i + 2 < argc) {
+            convert_in = argv[++i];
+            convert_out = argv[++i];
+        } else if (arg == "--eval" && i + 1 < argc) {
+            eval_file = argv[++i];
+        } else if (arg == "--egdb" && i + 1 < argc) {
+            egdb_file = argv[++i];
+        } else if (arg == "--build-egdb" && i + 1 < argc) {
+            egdb_build = stoi(argv[++i]);
+        } else if (arg == "--book" && i + 1 < argc) {
+            book_file = argv[++i];
+        } else if (arg == "--build-book" && i + 1 < argc) {
+            book_build = stoi(argv[++i]);
+        } else if (arg == "--book-boards" && i + 1 < argc) {
+            book_boards = argv[++i];
+        } else if (arg == "--depth" && i + 1 < argc) {
+            bench_depth = stoi(argv[++i]);
+        } else if (i + 1 < argc) {      //-i input.txt
+            inp_file = argv[++i];
         } else {
-            return "A" + to_string(m - k + 1);
+            inp_file = arg;
         }
     }
-
-    */
-    string get_pit_name(const board &t) const {
-        if (t.is_root) {
-            return "root";
+    opt.mcts_mb = hash_mb;
+    if (!decode_file.empty()) {
+        ifstream fin(decode_file, ios::in | ios::binary);
+        if (!decode_log(fin, cout)) {
+            cerr << decode_file << ": not a traverse log" << endl;
+            return 1;
         }
-        return get_pit_name(t.last_move);
+        return 0;
     }
-
-    string disp(const int x) const {
-        if (x == MIN_INT) {
-            return "-Infinity";
+    if (!convert_in.empty()) {
+        if (!convert_records(convert_in, convert_out, cout)) {
+            cerr << convert_in << ": cannot convert" << endl;
+            return 1;
         }
-        if (x == MAX_INT) {
-            return "Infinity";
+        return 0;
+    }
+    if (egdb_build > 0) {
+        return endgame_db::build(egdb_file, egdb_build, cout)? 0: 1;
+    }
+    endgame_db egdb;
+    if (egdb.open(egdb_file)) {
+        opt.egdb = &egdb;
+    }
+    if (book_build > 0) {
+        vector <pair <int, int> > boards;
+        stringstream ss(book_boards);
+        string t;
+        int pits, stones;
+        char x;
+        while (getline(ss, t, ',')) {
+            stringstream bs(t);
+            if (!(bs >> pits >> x >> stones) || x != 'x' || pits < 3 || pits > MAX_PIT || stones < 1) {
+                cerr << t << ": board is <pits>x<stones>, 3 ~ " << MAX_PIT << " pits" << endl;
+                return 1;
+            }
+            boards.push_back(make_pair(pits, stones));
         }
-        return to_string(x);
+        return build_book(book_file, boards, book_build, bench_depth? bench_depth: 14, hash_mb, opt, jobs, cout)? 0: 1;
     }
-    string log_string(const board &t, const int depth, const int val, const bool prune) const {
-        string my_log = get_pit_name(t) + "," + disp(depth) + "," + disp(val);
-        if (prune) {
-            my_log += "," + disp(t.alpha) + "," + disp(t.beta);
+    opening_book book;
+    if (book.open(book_file)) {
+        opt.book = &book;
+    }
+    eval_params eval;
+    if (!eval_file.empty()) {
+        ifstream fin(eval_file);
+        if (!fin || !eval.load(fin)) {
+            cerr << eval_file << ": bad evaluation parameters" << endl;
+            return 1;
         }
-        return my_log;
+        opt.eval = &eval;
     }
-    void reset() {                  //Reset a node' alpha beta val...
-        alpha = MIN_INT;
-        beta = MAX_INT;
-        is_root = true;
-        history.clear();
-        last_move = -1;
-        whom = (who == player1)? player2: player1;
+    if (server) {
+        engine_server(hash_mb, tt_replace, opt).run(cin);
+        return 0;
     }
-};
-
-int main(int argc, char *argv[]) {
-    string inp_file = "input.txt";
-    if (argc == 3) {
-        inp_file = argv[2];
+    if (host) {
+        match_host(hash_mb, tt_replace, opt, jobs).run(cin);
+        return 0;
+    }
+    if (batch) {
+        opt.verbose = false;
+        if (inp_file != "-" && position_file::is_binary(inp_file)) {
+            position_file positions;
+            if (!positions.open(inp_file)) {
+                cerr << inp_file << ": bad position file" << endl;
+                return 1;
+            }
+            size_t next = 0;
+            run_batch([&](input_case &c) {
+                if (next == positions.size()) {
+                    return false;
+                }
+                c = record_case(positions[next++]);
+                return true;
+            }, cout, hash_mb, tt_replace, fixed_depth, opt, jobs);
+            return 0;
+        }
+        ifstream fin;
+        if (inp_file != "-") {
+            fin.open(inp_file);
+        }
+        istream &in = (inp_file == "-")? cin: fin;
+        run_batch([&](input_case &c) {
+            return read_case(in, c);
+        }, cout, hash_mb, tt_replace, fixed_depth, opt, jobs);
+        return 0;
     }
     ifstream fin(inp_file);
-    
-    int task, who, cutoff, man1, man2;
-    double time_remain;
-    fin >> task >> who;
-
-
-
-    if (task == 4) {
-        //Competition
-        fin >> time_remain;
-        cutoff = 1;
-    } else {
-        fin >> cutoff;
+    if (bench_smp) {
+        bench_threads(fin, bench_depth, hash_mb, opt);
+        return 0;
+    }
+    if (bench_order) {
+        bench_ordering(fin, bench_depth, hash_mb, opt);
+        return 0;
+    }
+    if (bench_select) {
+        bench_selective(fin, bench_depth, hash_mb, opt);
+        return 0;
     }
 
-
-
-
-    string line;
-    getline(fin, line);             //consuming the line
-    
-    vector <int> p1, p2;
-    
-    getline(fin, line);             //player2
-    line_tokenization(line, p2);
-    
-    getline(fin, line);             //player1
-    line_tokenization(line, p1);
-    
-    fin >> man2 >> man1;
+    input_case c;
+    read_case(fin, c);
     fin.close();
+    int task = c.task;
 
-
-    board my_board(task, cutoff, who, p2, p1, man2, man1);
+    board my_board(c.task, c.cutoff, c.who, c.p2, c.p1, c.man2, c.man1);
+    trans_table tt(task == TASK_COMPETITION? hash_mb: 0, tt_replace);
+    my_board.use_table(&tt);
+    my_board.set_options(opt);
+    if ((task == TASK_COMPETITION || task == TASK_MCTS) && !fixed_depth) {
+        my_board.set_clock(c.time_remain);
+    }
     vector <string> history_moves;
-    vector <string> traverse_log;
     if (0) {
         /*
          Test mode
@@ -610,8 +3958,7 @@ int main(int argc, char *argv[]) {
         cout << my_board << endl;
         while (!my_board.game_over()) {
             cout << "#" << (++step >> 1) << ":" << endl;
-            vector <string> traverse_log;
-            my_board = my_board.move(history_moves, traverse_log, false);
+            my_board = my_board.move(history_moves);
             cout << my_board << endl;
             cout << "History moves: " << history_moves << endl << "---" << endl;
         }
@@ -619,28 +3966,25 @@ int main(int argc, char *argv[]) {
         
         //cout << my_board.move(3) << endl;
     } else {
-        if (task != 4) {
+        if (task != TASK_COMPETITION && task != TASK_MCTS) {
             /*
              Start of the homework
              */
             ofstream fnext("next_state.txt");
-            ofstream flog("traverse_log.txt");
+            ofstream flog(binary_log? "traverse_log.bin": "traverse_log.txt", binary_log? ios::out | ios::binary: ios::out);
+            log_writer log(flog, my_board.size(), task == TASK_ALPHA_BETA, binary_log? LOG_BINARY: LOG_TEXT);
             if (task == 2) {
-                flog << "Node,Depth,Value" << endl;
+                log.header("Node,Depth,Value");
             } else if (task == 3) {
-                flog << "Node,Depth,Value,Alpha,Beta" << endl;
+                log.header("Node,Depth,Value,Alpha,Beta");
             }
 
             cout << my_board << endl;
 
-            my_board = my_board.move(history_moves, traverse_log);
+            my_board = my_board.move(history_moves, &log);
             cout << my_board << endl;
+            log.flush();
 
-            for (auto e: traverse_log) {
-                flog << e << endl;
-            }
-
-            
             fnext << my_board.to_str() << endl;
             
             fnext.close();
@@ -649,8 +3993,7 @@ int main(int argc, char *argv[]) {
         } else {
             //Competition!
             cout << my_board << endl;
-            my_board = my_board.move(history_moves, traverse_log, false);
-            cout << traverse_log << endl;
+            my_board = my_board.move(history_moves);
             cout << my_board << endl;
             cout << "History moves: " << history_moves << endl;
             ofstream fmove("output.txt");
@@ -661,4 +4004,5 @@ int main(int argc, char *argv[]) {
         }
     }
     return 0;
-}
\ No newline at end of file
+}
+#endif
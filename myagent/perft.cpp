@@ -0,0 +1,237 @@
+/*
+ Move generation benchmark and correctness check. Built from the same engine:
+ make perft
+
+ ./perft [input.txt] [--depth 6] [--hash 64] [--threads 4] [--divide] [--reference]
+ ./perft --check [perft.txt] [--hash 64] [--threads 4] [--reference]
+
+ Counts the positions depth sowings ahead of the input's position. Each
+ move is one ply, an extra turn included, and a finished game is a leaf
+ wherever it ends. --reference sows stone by stone with play_reference.
+ */
+#define MYAGENT_NO_MAIN
+#include "myagent.cpp"
+
+/*
+ Subtree counts by position and depth, always replaced. Each thread has
+ its own, so no locking. Below PERFT_HASH_DEPTH a probe costs more than
+ the count.
+ */
+#define PERFT_HASH_DEPTH 4
+
+struct perft_entry {
+    uint64_t hash;
+    uint64_t count;
+    int depth;                      //-1: empty
+};
+
+class perft_table {
+private:
+    vector <perft_entry> e;
+    uint64_t mask;
+
+public:
+    perft_table(const size_t mb) : mask(0) {
+        size_t n = 0;
+        while (mb && (max(n, (size_t) 1) << 1) * sizeof(perft_entry) <= (mb << 20)) {
+            n = max(n, (size_t) 1) << 1;
+        }
+        e.assign(n, perft_entry{0, 0, -1});
+        mask = n? n - 1: 0;
+    }
+    bool enabled() const {
+        return !e.empty();
+    }
+    bool probe(const state &s, const int depth, uint64_t &count) const {
+        const perft_entry &p = e[(s.hash ^ depth) & mask];
+        if (p.depth == depth && p.hash == s.hash) {
+            count = p.count;
+            return true;
+        }
+        return false;
+    }
+    void store(const state &s, const int depth, const uint64_t count) {
+        e[(s.hash ^ depth) & mask] = perft_entry{s.hash, count, depth};
+    }
+};
+
+uint64_t perft(const state &s, const int depth, perft_table &tt, const bool reference) {
+    if (depth == 0 || s.game_over()) {
+        return 1;
+    }
+    int cand[MAX_PIT];
+    int nc = s.candidates(cand);
+    if (depth == 1) {                       //Bulk count: every child is a leaf
+        return nc;
+    }
+    uint64_t count = 0;
+    bool hashed = tt.enabled() && depth >= PERFT_HASH_DEPTH;
+    if (hashed && tt.probe(s, depth, count)) {
+        return count;
+    }
+    for (int i = 0; i < nc; ++i) {
+        state t = s;
+        if (reference) {
+            t.play_reference(cand[i]);
+        } else {
+            t.play(cand[i]);
+        }
+        count += perft(t, depth - 1, tt, reference);
+    }
+    if (hashed) {
+        tt.store(s, depth, count);
+    }
+    return count;
+}
+
+/*
+ Split at the root: threads take root moves in turn, each with its own
+ table of hash_mb / threads.
+ */
+uint64_t perft_root(const state &root, const int depth, const size_t hash_mb, const int threads, const bool reference,
+                    vector <pair <int, uint64_t> > *divide) {
+    if (depth == 0 || root.game_over()) {
+        return 1;
+    }
+    int cand[MAX_PIT];
+    int nc = root.candidates(cand);
+    vector <uint64_t> counts(nc, 0);
+    atomic <int> next(0);
+    auto worker = [&]() {
+        perft_table tt(hash_mb / threads);
+        for (int i = next++; i < nc; i = next++) {
+            state t = root;
+            if (reference) {
+                t.play_reference(cand[i]);
+            } else {
+                t.play(cand[i]);
+            }
+            counts[i] = perft(t, depth - 1, tt, reference);
+        }
+    };
+    vector <thread> workers;
+    for (int i = 1; i < threads; ++i) {
+        workers.push_back(thread(worker));
+    }
+    worker();
+    for (auto &t: workers) {
+        t.join();
+    }
+    uint64_t total = 0;
+    for (int i = 0; i < nc; ++i) {
+        total += counts[i];
+        if (divide) {
+            divide->push_back(make_pair(cand[i], counts[i]));
+        }
+    }
+    return total;
+}
+
+/*
+ Reference counts, one position per line, "#" starts a comment:
+ depth count player man2 man1 <player 2 pits> <player 1 pits>
+ Returns the number of mismatches.
+ */
+int check_file(const string &file, const size_t hash_mb, const int threads, const bool reference) {
+    ifstream fin(file);
+    if (!fin) {
+        cerr << file << ": cannot read" << endl;
+        return 1;
+    }
+    string line;
+    int bad = 0, lines = 0;
+    double elapsed = 0;
+    uint64_t leaves = 0;
+    while (getline(fin, line)) {
+        line = line.substr(0, line.find('#'));
+        stringstream ss(line);
+        vector <long long> x;
+        long long v;
+        while (ss >> v) {
+            x.push_back(v);
+        }
+        if (x.empty()) {
+            continue;
+        }
+        int n = ((int) x.size() - 5) / 2;
+        if (n < 3 || n > MAX_PIT || (int) x.size() != 5 + 2 * n || x[2] < 1 || x[2] > 2) {
+            cerr << file << ": bad line " << line << endl;
+            ++bad;
+            continue;
+        }
+        vector <int> p2(x.begin() + 5, x.begin() + 5 + n), p1(x.begin() + 5 + n, x.end());
+        board b(TASK_COMPETITION, 0, (int) x[2], p2, p1, (int) x[3], (int) x[4]);
+        search_clock::time_point start = search_clock::now();
+        uint64_t count = perft_root(b.get_state(), (int) x[0], hash_mb, threads, reference, nullptr);
+        elapsed += chrono::duration<double>(search_clock::now() - start).count();
+        leaves += count;
+        ++lines;
+        if (count != (uint64_t) x[1]) {
+            cout << "FAIL depth " << x[0] << ": " << count << ", expected " << x[1] << ":" << line << endl;
+            ++bad;
+        }
+    }
+    cout << fixed << setprecision(3) << lines << " positions, " << bad << " mismatches, " << leaves << " leaves in " << elapsed << "s ("
+         << setprecision(0) << leaves / max(elapsed, 1e-9) << " leaves/s)" << endl;
+    return bad;
+}
+
+int main(int argc, char *argv[]) {
+    string file = "input.txt";
+    string check_path;
+    int depth = 6;
+    size_t hash_mb = 0;                 //0: no table
+    int threads = 1;
+    bool divide = false;                //Counts per root move
+    bool reference = false;             //play_reference instead of play
+    bool check = false;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--depth" && i + 1 < argc) {
+            depth = stoi(argv[++i]);
+        } else if (arg == "--hash" && i + 1 < argc) {
+            hash_mb = stoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = max(stoi(argv[++i]), 1);
+        } else if (arg == "--divide") {
+            divide = true;
+        } else if (arg == "--reference") {
+            reference = true;
+        } else if (arg == "--check") {
+            check = true;
+            check_path = "perft.txt";
+        } else if (arg == "-i" && i + 1 < argc) {
+            file = argv[++i];
+        } else if (check) {
+            check_path = arg;
+        } else {
+            file = arg;
+        }
+    }
+    if (check) {
+        return check_file(check_path, hash_mb, threads, reference)? 1: 0;
+    }
+
+    ifstream fin(file);
+    input_case c;
+    if (!read_case(fin, c)) {
+        cerr << file << ": no position" << endl;
+        return 1;
+    }
+    board b(TASK_COMPETITION, 0, c.who, c.p2, c.p1, c.man2, c.man1);
+    cout << b << endl;
+    for (int d = 1; d <= depth; ++d) {
+        vector <pair <int, uint64_t> > moves;
+        search_clock::time_point start = search_clock::now();
+        uint64_t count = perft_root(b.get_state(), d, hash_mb, threads, reference, (divide && d == depth)? &moves: nullptr);
+        double elapsed = chrono::duration<double>(search_clock::now() - start).count();
+        cout << fixed << setprecision(3) << "Depth " << d << ": " << count << " leaves, " << elapsed << "s, "
+             << setprecision(0) << count / max(elapsed, 1e-9) << " leaves/s" << endl;
+        for (auto &e: moves) {
+            int n = b.size();           //Pit names as in board::get_pit_name
+            cout << "  " << ((e.first < n)? "B" + to_string(e.first + 2): "A" + to_string(2 * n - e.first + 1)) << ": " << e.second << endl;
+        }
+    }
+    cout.unsetf(ios::fixed);
+    return 0;
+}
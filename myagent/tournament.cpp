@@ -0,0 +1,633 @@
+/*
+ Self-play tournament and speed benchmark. Built from the same engine:
+ make tournament
+
+ ./tournament -a "depth=8" -b "depth=8,ordering=0" [--openings 20] [--jobs 4]
+ ./tournament --bench [--depth 10] [cases.txt]
+ ./tournament --bench-sizes [--depth 10] [--openings 5]
+ ./tournament --check-sowing [1000000]
+ ./tournament -a "depth=6" -b "depth=6" --record games.txt|games.bin
+ ./tournament --tune games.txt|games.bin [--eval start.txt] [--out tuned.txt]
+ */
+#define MYAGENT_NO_MAIN
+#include "myagent.cpp"
+
+#include <random>
+
+/*
+ One engine configuration, parsed from "key=value,..." with keys
+ depth (fixed depth, 0 = compute_cutoff), time (seconds per move,
+ iterative deepening), threads, hash (MiB), ordering (0/1), pvs (0/1),
+ quiesce (0/1), specialize (0/1), lmr, futility, razor (0/1, selective
+ search),
+ mcts (0/1, Monte Carlo tree search instead of alpha-beta: time, or
+ MCTS_PLAYOUTS playouts per move), egdb (file), eval (parameter file).
+ */
+struct engine_config {
+    string name;
+    int depth;
+    double time;
+    bool mcts;
+    size_t hash_mb;
+    string egdb_file;
+    eval_params eval;
+    search_options opt;
+
+    engine_config() {
+        depth = 0;
+        time = 0;
+        mcts = false;
+        hash_mb = 16;
+        opt.verbose = false;
+    }
+};
+
+bool parse_config(const string &spec, engine_config &cfg) {
+    cfg.name = spec.empty()? "default": spec;
+    stringstream ss(spec);
+    string t;
+    while (getline(ss, t, ',')) {
+        size_t eq = t.find('=');
+        if (eq == string::npos) {
+            return false;
+        }
+        string key = t.substr(0, eq), val = t.substr(eq + 1);
+        if (key == "depth") {
+            cfg.depth = stoi(val);
+        } else if (key == "time") {
+            cfg.time = stod(val);
+        } else if (key == "threads") {
+            cfg.opt.threads = stoi(val);
+        } else if (key == "hash") {
+            cfg.hash_mb = stoi(val);
+        } else if (key == "ordering") {
+            cfg.opt.ordering = stoi(val) != 0;
+        } else if (key == "pvs") {
+            cfg.opt.pvs = stoi(val) != 0;
+        } else if (key == "quiesce") {
+            cfg.opt.quiesce = stoi(val) != 0;
+        } else if (key == "mcts") {
+            cfg.mcts = stoi(val) != 0;
+        } else if (key == "specialize") {
+            cfg.opt.specialize = stoi(val) != 0;
+        } else if (key == "lmr") {
+            cfg.opt.lmr = stoi(val) != 0;
+        } else if (key == "futility") {
+            cfg.opt.futility = stoi(val) != 0;
+        } else if (key == "razor") {
+            cfg.opt.razor = stoi(val) != 0;
+        } else if (key == "egdb") {
+            cfg.egdb_file = val;
+        } else if (key == "eval") {
+            ifstream fin(val);
+            if (!fin || !cfg.eval.load(fin)) {
+                return false;
+            }
+            cfg.opt.eval = &cfg.eval;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ Openings: the standard start with a few random turns played, each seed
+ giving the same position every run.
+ */
+board make_opening(const int n, const int stones, const int turns, const unsigned seed) {
+    mt19937 rng(seed);
+    vector <int> side(n, stones);
+    while (true) {
+        board b(TASK_COMPETITION, 0, 1, side, side, 0, 0);
+        for (int t = 0; t < turns && !b.game_over(); ++t) {
+            int who = b.turn();
+            while (!b.game_over() && b.turn() == who) {
+                vector <int> cand = b.get_candidate();
+                b = b.move(cand[rng() % cand.size()]);
+            }
+        }
+        if (!b.game_over()) {
+            return b;
+        }
+    }
+}
+
+struct engine_totals {
+    long long nodes;
+    double elapsed;
+    int moves;
+
+    engine_totals() {
+        nodes = 0;
+        elapsed = 0;
+        moves = 0;
+    }
+    engine_totals &operator+=(const engine_totals &o) {
+        nodes += o.nodes;
+        elapsed += o.elapsed;
+        moves += o.moves;
+        return *this;
+    }
+};
+
+/*
+ One game, engine[0] playing player 1. Returns man1 - man2 at the end.
+ The position before every turn goes to seen, if given, with the mover's
+ first pit and value.
+ */
+int play_game(board b, const engine_config *engine[2], trans_table *tt[2], engine_totals total[2],
+              vector <position_record> *seen) {
+    for (int i = 0; i < 2; ++i) {
+        tt[i]->clear();
+    }
+    for (int ply = 0; ply < 1000 && !b.game_over(); ++ply) {
+        int k = b.turn() - 1;
+        const engine_config &cfg = *engine[k];
+        b.use_table(tt[k]);
+        b.set_options(cfg.opt);
+        b.set_task(cfg.mcts? TASK_MCTS: TASK_COMPETITION);
+        if (cfg.time > 0) {
+            b.set_clock(cfg.time * max(cfg.opt.moves_to_go, 1));
+        } else {
+            b.set_clock(0);
+            if (cfg.depth > 0) {
+                b.set_depth(cfg.depth);
+            } else {
+                vector <int> p = b.get_position();
+                b.set_depth(b.compute_cutoff(b.size(), accumulate(p.begin(), p.end(), 0)));
+            }
+        }
+        position_record rec = make_record(b.get_state());
+        vector <string> moves;
+        search_report r;
+        b = b.move(moves, nullptr, &r);
+        if (seen) {
+            rec.best = r.pv.empty()? -1: r.pv[0];
+            rec.score = r.val;
+            seen->push_back(rec);
+        }
+        total[k].nodes += r.nodes;
+        total[k].elapsed += r.elapsed;
+        ++total[k].moves;
+    }
+    return b.mancala(1) - b.mancala(2);
+}
+
+double elo(const double score) {
+    double p = min(max(score, 1e-3), 1 - 1e-3);
+    return (p == 0.5)? 0: -400 * log10(1 / p - 1);
+}
+
+/*
+ Game records for the tuner, one position per line:
+ n who man1 man2 pit[0] ... pit[2n - 1] result
+ with the result of the game for player 1: 1, 0.5 or 0.
+ A file ending in .bin gets binary positions instead (see position_record),
+ with the game id, the final margin, and the mover's first pit and value.
+ */
+class game_recorder {
+private:
+    ofstream text;
+    unique_ptr <position_writer> binary;
+
+public:
+    static bool is_binary(const string &file) {
+        return file.size() > 4 && file.compare(file.size() - 4, 4, ".bin") == 0;
+    }
+    game_recorder(const string &file) {
+        if (is_binary(file)) {
+            binary.reset(new position_writer(file));
+        } else {
+            text.open(file);
+        }
+    }
+    void write(const vector <position_record> &seen, const int game, const int margin) {
+        const char *result = (margin > 0)? "1": (margin < 0)? "0": "0.5";
+        for (auto r: seen) {
+            if (binary) {
+                r.game = game;
+                r.result = margin;
+                binary->write(r);
+                continue;
+            }
+            text << (int) r.n << " " << (int) r.who << " " << r.man1 << " " << r.man2;
+            for (int i = 0; i < 2 * r.n; ++i) {
+                text << " " << r.pit[i];
+            }
+            text << " " << result << '\n';
+        }
+    }
+};
+
+void run_tournament(engine_config cfg[2], const int n, const int stones, const int openings, const int turns,
+                    const unsigned seed, const int jobs, game_recorder *record) {
+    endgame_db egdb[2];
+    for (int i = 0; i < 2; ++i) {
+        if (!cfg[i].egdb_file.empty() && egdb[i].open(cfg[i].egdb_file)) {
+            cfg[i].opt.egdb = &egdb[i];
+        }
+    }
+    mutex lock;
+    atomic <int> next(0);
+    int win = 0, draw = 0, loss = 0;        //For engine A
+    engine_totals total[2];
+    int games = openings * 2;
+
+    auto worker = [&]() {
+        trans_table tt_a(cfg[0].hash_mb), tt_b(cfg[1].hash_mb);
+        for (int g = next++; g < games; g = next++) {
+            int swap = g & 1;                   //Odd games: B plays player 1
+            const engine_config *engine[2] = {&cfg[swap], &cfg[1 - swap]};
+            trans_table *tt[2] = {swap? &tt_b: &tt_a, swap? &tt_a: &tt_b};
+            engine_totals t[2];
+            vector <position_record> seen;
+            int d = play_game(make_opening(n, stones, turns, seed + (g >> 1)), engine, tt, t, record? &seen: nullptr);
+            int a = swap? -d: d;                //A's margin
+            lock_guard <mutex> guard(lock);
+            if (record) {
+                record->write(seen, g + 1, d);
+            }
+            win += a > 0;
+            draw += a == 0;
+            loss += a < 0;
+            total[0] += t[swap];
+            total[1] += t[1 - swap];
+            cout << "Game " << setw(4) << g + 1 << ": opening " << (g >> 1) + 1 << ", A as player " << swap + 1
+                 << ", A " << ((a > 0)? "wins": (a < 0)? "loses": "draws") << " by " << abs(a) << endl;
+        }
+    };
+    vector <thread> workers;
+    for (int i = 1; i < jobs; ++i) {
+        workers.push_back(thread(worker));
+    }
+    worker();
+    for (auto &t: workers) {
+        t.join();
+    }
+
+    int played = win + draw + loss;
+    double score = (win + draw * 0.5) / max(played, 1);
+    double var = (win * pow(1 - score, 2) + draw * pow(0.5 - score, 2) + loss * pow(score, 2)) / max(played, 1);
+    double margin = 1.96 * sqrt(var / max(played, 1));
+    cout << fixed << setprecision(1) << endl;
+    cout << "A: " << cfg[0].name << endl << "B: " << cfg[1].name << endl;
+    cout << "Games " << played << ": A +" << win << " =" << draw << " -" << loss << ", score " << 100 * score << "%" << endl;
+    cout << "Elo A - B: " << showpos << elo(score) << noshowpos << " +/- " << (elo(score + margin) - elo(score - margin)) / 2 << endl;
+    for (int i = 0; i < 2; ++i) {
+        cout << (i? "B": "A") << ": " << setprecision(0) << total[i].nodes / max(total[i].elapsed, 1e-9) << " nodes/s, "
+             << setprecision(3) << total[i].elapsed / max(total[i].moves, 1) << "s per move" << endl;
+    }
+    cout.unsetf(ios::fixed);
+}
+
+/*
+ Fixed-depth speed benchmark, one thread. The total node count is a
+ signature of the search: it changes only when the search does.
+ */
+void run_bench(const engine_config &cfg, const string &file, const int depth, const int n, const int stones,
+               const int openings, const int turns, const unsigned seed) {
+    vector <board> positions;
+    if (!file.empty()) {
+        ifstream fin(file);
+        input_case c;
+        while (read_case(fin, c)) {
+            positions.push_back(board(TASK_COMPETITION, 0, c.who, c.p2, c.p1, c.man2, c.man1));
+        }
+    } else {
+        for (int i = 0; i < openings; ++i) {
+            positions.push_back(make_opening(n, stones, turns, seed + i));
+        }
+    }
+    trans_table tt(cfg.hash_mb);
+    search_options opt = cfg.opt;
+    opt.threads = 1;
+    long long nodes = 0;
+    double elapsed = 0;
+    cout << "Position  Depth        Nodes     Time(s)     Nodes/s" << endl;
+    for (size_t i = 0; i < positions.size(); ++i) {
+        board b = positions[i];
+        tt.clear();
+        b.use_table(&tt);
+        b.set_options(opt);
+        int d = depth > 0? depth: b.depth();
+        search_report r = b.analyse(d);
+        nodes += r.nodes;
+        elapsed += r.elapsed;
+        cout << fixed << setprecision(3) << setw(8) << i << setw(7) << d << setw(13) << r.nodes << setw(12) << r.elapsed
+             << setw(12) << setprecision(0) << r.nodes / max(r.elapsed, 1e-9) << endl;
+    }
+    cout << "Total" << setw(23) << nodes << setw(12) << setprecision(3) << elapsed
+         << setw(12) << setprecision(0) << nodes / max(elapsed, 1e-9) << endl;
+    cout.unsetf(ios::fixed);
+}
+
+/*
+ The search compiled for each board size against the one for any size,
+ on the same openings and depth: nodes/s of both and the speedup. The
+ node counts must agree.
+ */
+void run_bench_sizes(const engine_config &cfg, const int depth, const int stones, const int openings, const int turns, const unsigned seed) {
+    trans_table tt(cfg.hash_mb);
+    search_options opt[2] = {cfg.opt, cfg.opt};
+    opt[0].specialize = false;
+    opt[1].specialize = true;
+    cout << "Pits  Depth        Nodes   Generic n/s  Specialized n/s  Speedup" << endl;
+    for (int n = 3; n <= MAX_PIT; ++n) {
+        long long nodes[2] = {0, 0};
+        double elapsed[2] = {0, 0};
+        int d = 0;
+        for (int i = 0; i < openings; ++i) {
+            board b = make_opening(n, stones, turns, seed + i);
+            d = depth > 0? depth: b.depth();
+            for (int k = 0; k < 2; ++k) {
+                opt[k].threads = 1;
+                tt.clear();
+                b.use_table(&tt);
+                b.set_options(opt[k]);
+                search_report r = b.analyse(d);
+                nodes[k] += r.nodes;
+                elapsed[k] += r.elapsed;
+            }
+        }
+        double rate[2] = {nodes[0] / max(elapsed[0], 1e-9), nodes[1] / max(elapsed[1], 1e-9)};
+        cout << fixed << setw(4) << n << setw(7) << d << setw(13) << nodes[1] << setprecision(0) << setw(14) << rate[0]
+             << setw(17) << rate[1] << setprecision(2) << setw(8) << rate[1] / max(rate[0], 1e-9) << "x"
+             << ((nodes[0] != nodes[1])? "  node counts differ": "") << endl;
+    }
+    cout.unsetf(ios::fixed);
+}
+
+/*
+ Differential check of state::play against the stone by stone
+ play_reference on random positions, from a few stones per pit to
+ several laps. Returns the number of mismatches.
+ */
+long long check_sowing(const long long count, const unsigned seed) {
+    mt19937 rng(seed);
+    const int scale[] = {3, 12, 40, 400, 5000};
+    long long bad = 0;
+    for (long long t = 0; t < count; ++t) {
+        state s;
+        s.n = 3 + rng() % (MAX_PIT - 2);
+        int top = scale[rng() % 5];
+        for (int i = 0; i < s.size(); ++i) {
+            s.pit[i] = (rng() % 4 == 0)? 0: rng() % (top + 1);
+        }
+        s.man1 = rng() % 50;
+        s.man2 = rng() % 50;
+        s.who = 1 + rng() % 2;
+        s.whom = 3 - s.who;
+        s.last_move = -1;
+        s.compute_hash();
+        s.count_sides();
+        int cand[MAX_PIT];
+        int nc = s.candidates(cand);
+        if (s.game_over() || nc == 0) {
+            continue;
+        }
+        int k = cand[rng() % nc];
+        state a = s, b = s;
+        a.play(k);
+        b.play_reference(k);
+        bool same = a.man1 == b.man1 && a.man2 == b.man2 && a.who == b.who && a.whom == b.whom && a.hash == b.hash
+                    && a.side(1) == b.side(1) && a.side(2) == b.side(2)
+                    && equal(a.pit, a.pit + a.size(), b.pit);
+        //capture() against the store: what it gained less what was sown into it, unless the game ended
+        int m = s.size(), to_mancala = ((s.who == 1)? s.n: m) - k;
+        int sown = s.pit[k] / (m + 1) + (s.pit[k] % (m + 1) >= to_mancala);
+        int gain = (s.who == 1)? b.man1 - s.man1: b.man2 - s.man2;
+        same = same && (b.game_over() || gain - sown == s.capture(k));
+        if (!same && bad++ < 10) {
+            cout << "Mismatch: " << s.n << " pits, player " << s.who << ", pit " << k << ": "
+                 << vector <int> (s.pit, s.pit + s.size()) << " " << s.man1 << " " << s.man2 << endl;
+        }
+    }
+    cout << count << " random moves, " << bad << " mismatches" << endl;
+    return bad;
+}
+
+/*
+ Texel tuning: the evaluation, through a logistic curve, should predict
+ the game results of the recorded positions. The scale of the curve is
+ fitted first, then every parameter in turn is moved by a step while that
+ lowers the mean squared error, the step halving when nothing moves.
+ The error is summed over the positions by all threads.
+ */
+struct tune_sample {
+    state s;
+    float result;
+};
+
+void add_sample(vector <tune_sample> &data, const tune_sample &t) {
+    int left = t.s.side(1) + t.s.side(2);
+    if (abs(t.s.man1 - t.s.man2) <= left && left > 0) {          //Decided positions are not evaluated
+        data.push_back(t);
+    }
+}
+
+bool read_records(const string &file, vector <tune_sample> &data) {
+    if (position_file::is_binary(file)) {
+        position_file in;
+        if (!in.open(file)) {
+            return false;
+        }
+        for (size_t i = 0; i < in.size(); ++i) {
+            if (in[i].n < 3 || in[i].n > MAX_PIT || !in[i].game) {
+                return false;
+            }
+            tune_sample t;
+            t.s = record_state(in[i]);
+            t.result = (in[i].result > 0)? 1: (in[i].result < 0)? 0: 0.5;
+            add_sample(data, t);
+        }
+        return true;
+    }
+    ifstream in(file);
+    if (!in) {
+        return false;
+    }
+    string line;
+    while (getline(in, line)) {
+        stringstream ss(line);
+        tune_sample t;
+        t.s.last_move = -1;
+        t.s.whom = 0;
+        if (!(ss >> t.s.n >> t.s.who >> t.s.man1 >> t.s.man2) || t.s.n < 3 || t.s.n > MAX_PIT) {
+            return false;
+        }
+        for (int i = 0; i < t.s.size(); ++i) {
+            ss >> t.s.pit[i];
+        }
+        ss >> t.result;
+        if (ss.fail()) {
+            return false;
+        }
+        t.s.count_sides();
+        add_sample(data, t);
+    }
+    return true;
+}
+
+double tune_error(const eval_params &p, const vector <tune_sample> &data, const double k, const int jobs) {
+    vector <double> sum(jobs, 0);
+    auto part = [&](const int id) {
+        double e = 0;
+        for (size_t i = id; i < data.size(); i += jobs) {
+            double x = (double) p.score(data[i].s) / EVAL_SCALE;
+            double d = data[i].result - 1 / (1 + exp(-k * x));
+            e += d * d;
+        }
+        sum[id] = e;
+    };
+    vector <thread> workers;
+    for (int i = 1; i < jobs; ++i) {
+        workers.push_back(thread(part, i));
+    }
+    part(0);
+    for (auto &t: workers) {
+        t.join();
+    }
+    return accumulate(sum.begin(), sum.end(), 0.0) / max(data.size(), (size_t) 1);
+}
+
+void run_tune(const string &file, eval_params p, const string &out_file, const int jobs) {
+    vector <tune_sample> data;
+    if (!read_records(file, data) || data.empty()) {
+        cerr << file << ": no game records" << endl;
+        return;
+    }
+    double lo = 1e-4, hi = 1;                   //Golden section on log k
+    for (int it = 0; it < 40; ++it) {
+        double a = exp(log(lo) + (log(hi) - log(lo)) * 0.382), b = exp(log(lo) + (log(hi) - log(lo)) * 0.618);
+        if (tune_error(p, data, a, jobs) < tune_error(p, data, b, jobs)) {
+            hi = b;
+        } else {
+            lo = a;
+        }
+    }
+    double k = sqrt(lo * hi);
+    double best = tune_error(p, data, k, jobs);
+    cout << data.size() << " positions, k " << k << ", error " << best << endl;
+
+    for (int step = 16; step >= 1; ) {
+        bool moved = false;
+        for (int i = 0; i < p.count(); ++i) {
+            if (!p.used(i)) {
+                continue;
+            }
+            for (int dir = 1; dir >= -1; dir -= 2) {
+                p[i] += dir * step;
+                double e = tune_error(p, data, k, jobs);
+                if (e < best) {
+                    best = e;
+                    moved = true;
+                    break;
+                }
+                p[i] -= dir * step;
+            }
+        }
+        cout << "Step " << step << ": error " << best << endl;
+        ofstream out(out_file);
+        p.save(out);
+        if (!moved) {
+            step >>= 1;
+        }
+    }
+    cout << "Parameters in " << out_file << endl;
+}
+
+int main(int argc, char *argv[]) {
+    engine_config cfg[2];
+    string spec[2];
+    bool bench = false;
+    bool bench_sizes = false;
+    long long check = 0;                //Random moves for --check-sowing
+    string record_file;                 //Game records of the tournament
+    string tune_file;                   //Game records to tune on
+    string eval_file, out_file = "eval_tuned.txt";
+    string bench_file;
+    int depth = 0;
+    int n = 6, stones = 4;              //Starting position
+    int openings = 20;                  //Each played with both colors
+    int turns = 4;                      //Random turns from the start
+    unsigned seed = 1;
+    int jobs = max((int) thread::hardware_concurrency(), 1);
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-a" && i + 1 < argc) {
+            spec[0] = argv[++i];
+        } else if (arg == "-b" && i + 1 < argc) {
+            spec[1] = argv[++i];
+        } else if (arg == "--bench") {
+            bench = true;
+        } else if (arg == "--bench-sizes") {
+            bench_sizes = true;
+        } else if (arg == "--check-sowing") {
+            check = (i + 1 < argc && isdigit(argv[i + 1][0]))? stoll(argv[++i]): 1000000;
+        } else if (arg == "--record" && i + 1 < argc) {
+            record_file = argv[++i];
+        } else if (arg == "--tune" && i + 1 < argc) {
+            tune_file = argv[++i];
+        } else if (arg == "--eval" && i + 1 < argc) {
+            eval_file = argv[++i];
+        } else if (arg == "--out" && i + 1 < argc) {
+            out_file = argv[++i];
+        } else if (arg == "--depth" && i + 1 < argc) {
+            depth = stoi(argv[++i]);
+        } else if (arg == "--pits" && i + 1 < argc) {
+            n = stoi(argv[++i]);
+        } else if (arg == "--stones" && i + 1 < argc) {
+            stones = stoi(argv[++i]);
+        } else if (arg == "--openings" && i + 1 < argc) {
+            openings = stoi(argv[++i]);
+        } else if (arg == "--turns" && i + 1 < argc) {
+            turns = stoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = stoul(argv[++i]);
+        } else if (arg == "--jobs" && i + 1 < argc) {
+            jobs = max(stoi(argv[++i]), 1);
+        } else if (bench) {
+            bench_file = arg;
+        } else {
+            cerr << "Unknown argument " << arg << endl;
+            return 1;
+        }
+    }
+    for (int i = 0; i < 2; ++i) {
+        if (!parse_config(spec[i], cfg[i])) {
+            cerr << "Bad engine configuration " << spec[i] << endl;
+            return 1;
+        }
+    }
+    if (n < 3 || n > MAX_PIT || stones < 1) {
+        cerr << "Board of 3 ~ " << MAX_PIT << " pits with at least one stone each" << endl;
+        return 1;
+    }
+    if (game_recorder::is_binary(record_file) && 2LL * n * stones > RECORD_MAX_STONES) {
+        cerr << "Binary records take boards of up to " << RECORD_MAX_STONES << " stones" << endl;
+        return 1;
+    }
+    if (check) {
+        return check_sowing(check, seed)? 1: 0;
+    }
+    if (!tune_file.empty()) {
+        eval_params p;
+        ifstream fin(eval_file);
+        if (!eval_file.empty() && (!fin || !p.load(fin))) {
+            cerr << eval_file << ": bad evaluation parameters" << endl;
+            return 1;
+        }
+        run_tune(tune_file, p, out_file, jobs);
+        return 0;
+    }
+    if (bench_sizes) {
+        run_bench_sizes(cfg[0], depth, stones, openings, turns, seed);
+    } else if (bench) {
+        run_bench(cfg[0], bench_file, depth, n, stones, openings, turns, seed);
+    } else {
+        unique_ptr <game_recorder> record(record_file.empty()? nullptr: new game_recorder(record_file));
+        run_tournament(cfg, n, stones, openings, turns, seed, jobs, record.get());
+    }
+    return 0;
+}